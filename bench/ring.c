@@ -0,0 +1,98 @@
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ring.h"
+
+#define NUM_RECORDS 4000000
+#define CAPACITY    1024
+#define BATCH_SIZE  32
+
+typedef struct {
+    Ring* ring;
+    int num_records;
+    int batch_size;
+} Worker;
+
+static int64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void* produce(void* arg) {
+    Worker* worker = arg;
+    str batch[BATCH_SIZE];
+    for (int i = 0; i < worker->num_records;) {
+        int count = worker->num_records - i < worker->batch_size ? worker->num_records - i : worker->batch_size;
+        // The ring only moves the strings, so they don't need any memory
+        for (int j = 0; j < count; j++)
+            batch[j] = (str){.data = NULL, .len = i + j};
+        if (count == 1)
+            ring_push(worker->ring, batch[0]);
+        else
+            ring_push_n(worker->ring, batch, count);
+        i += count;
+    }
+    return NULL;
+}
+
+static void* consume(void* arg) {
+    Worker* worker = arg;
+    str batch[BATCH_SIZE];
+    int64_t total = 0;
+    while (true) {
+        int popped = worker->batch_size == 1 ? ring_pop(worker->ring, batch) : ring_pop_n(worker->ring, batch, worker->batch_size);
+        if (popped == 0)
+            break;
+        total += popped;
+    }
+    return (void*)(intptr_t)total;
+}
+
+static void run(RingMode mode, int num_threads, int batch_size) {
+    Ring* ring = ring_create(CAPACITY, mode);
+    int num_producers = mode == RingMpsc ? num_threads : 1;
+    int num_consumers = mode == RingSpmc ? num_threads : 1;
+    Worker producer = {.ring = ring, .num_records = NUM_RECORDS / num_producers, .batch_size = batch_size};
+    Worker consumer = {.ring = ring, .batch_size = batch_size};
+    pthread_t producers[num_producers];
+    pthread_t consumers[num_consumers];
+
+    int64_t start = monotonic_ns();
+    for (int i = 0; i < num_consumers; i++)
+        pthread_create(&consumers[i], NULL, consume, &consumer);
+    for (int i = 0; i < num_producers; i++)
+        pthread_create(&producers[i], NULL, produce, &producer);
+    for (int i = 0; i < num_producers; i++)
+        pthread_join(producers[i], NULL);
+    ring_close(ring);
+    int64_t total = 0;
+    for (int i = 0; i < num_consumers; i++) {
+        void* popped;
+        pthread_join(consumers[i], &popped);
+        total += (intptr_t)popped;
+    }
+    double seconds = (monotonic_ns() - start) / 1e9;
+
+    char* mode_names[] = {[RingSpsc] = "SPSC", [RingMpsc] = "MPSC", [RingSpmc] = "SPMC"};
+    printf("%-4s  %7d  %5d  %8.2f\n", mode_names[mode], num_threads, batch_size, total / seconds / 1e6);
+    ring_free(ring);
+}
+
+int main() {
+    printf("mode  threads  batch  Mrecords/s\n");
+    for (int batch_size = 1; batch_size <= BATCH_SIZE; batch_size *= BATCH_SIZE) {
+        run(RingSpsc, 1, batch_size);
+        for (int num_threads = 2; num_threads <= 8; num_threads *= 2)
+            run(RingMpsc, num_threads, batch_size);
+        for (int num_threads = 2; num_threads <= 8; num_threads *= 2)
+            run(RingSpmc, num_threads, batch_size);
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "file.h"
+#include "str.h"
+#include "vec.h"
+
+typedef enum {
+    DiffEqual,
+    DiffDelete,
+    DiffInsert
+} DiffOp;
+
+typedef struct {
+    DiffOp op;
+    //\ The edit covers `len` lines starting at `old_start`
+    //\ in the old lines (unless it's an insertion) and at
+    //\ `new_start` in the new lines (unless it's a
+    //\ deletion). Both starts are where the edit applies,
+    //\ even when the edit doesn't cover lines on that side.
+    int old_start;
+    int new_start;
+    int len;
+} DiffEdit;
+
+DEFINE_VEC(DiffEdit)
+
+typedef Vec(DiffEdit) diff_edit_arr;
+
+typedef struct {
+    //\ Names written in the `---` and `+++` header lines
+    //\ ("a" and "b" if empty).
+    str old_label;
+    str new_label;
+    //\ Unchanged lines shown around each change. 0 uses 3
+    //\ (like `diff -u`), and negative values show none.
+    int context;
+    //\ Whether the last old / new line has no newline after
+    //\ it, which is marked with "\ No newline at end of file"
+    //\ (`diff_files` sets these itself).
+    bool old_missing_newline;
+    bool new_missing_newline;
+} DiffOptions;
+
+/* diff */
+
+// Compute the shortest edit script turning `old_lines` into `new_lines`. Lines are hashed
+// to integer IDs, lines that only appear on one side are set aside, and Myers' algorithm
+// is run on the rest in linear space. Like `diff`, the search settles for a slightly
+// longer script when the inputs are very different, rather than taking quadratic time.
+// Consecutive edits always have different ops, and deletions come before insertions at
+// the same position.
+diff_edit_arr diff_lines(str_arr old_lines, str_arr new_lines);
+// Check whether an edit script changes anything.
+bool    diff_has_changes(diff_edit_arr edits);
+// Write an edit script as a unified diff (like `diff -u`), without anything if there
+// are no changes. Every output line ends with a newline, and a last line missing its
+// newline is followed by a marker line. Returns false if writing failed.
+bool    diff_write_unified(File* output, str_arr old_lines, str_arr new_lines, diff_edit_arr edits, DiffOptions options);
+// Diff the lines of two files (from their current positions) and write a unified diff
+// to `output`. Like `diff`, a last line without a newline differs from the same line with
+// one. Returns 1 if the files differ, 0 if they don't and -1 if reading or writing
+// failed, like the exit status of `diff`.
+int     diff_files(File* old_file, File* new_file, File* output, DiffOptions options);
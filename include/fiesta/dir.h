@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "str.h"
+
+typedef struct {
+    str path;
+    int64_t size;
+    int64_t modified_time;
+    bool is_directory;
+} DirEntry;
+
+typedef struct {
+    //\ Every filter is disabled when left zeroed, so
+    //\ `(DirWalkOptions){0}` lists every non-hidden file.
+    //\ `name_pattern` is a glob (e.g. "*.log") matched
+    //\ against entry names (only `*` and `?` wildcards are
+    //\ supported on Windows), and `extension` includes
+    //\ the dot (e.g. ".log").
+    str name_pattern;
+    str extension;
+    int64_t min_size;
+    int64_t max_size;
+    //\ Modification times are in seconds since the epoch,
+    //\ with `modified_after` inclusive and `modified_before`
+    //\ exclusive.
+    int64_t modified_after;
+    int64_t modified_before;
+    //\ A depth of 1 only lists the root directory's entries.
+    int max_depth;
+    //\ 0 uses one thread per online CPU. Windows walks
+    //\ always use the calling thread.
+    int num_threads;
+    bool include_directories;
+    bool include_hidden;
+    //\ Fill in the size and modification time of entries
+    //\ passed to callbacks even if no filter needs them.
+    bool stat_entries;
+    //\ Sort listed paths (they're unordered otherwise).
+    bool sorted;
+} DirWalkOptions;
+
+typedef struct {
+    str_arr paths;
+    //\ Blocks of memory that the paths are allocated from.
+    void* arena;
+} DirListing;
+
+//\ Called for each entry that passes the filters, from worker threads
+//\ (though never concurrently). The entry's path is only valid during
+//\ the call. Returning false stops the walk.
+typedef bool (*DirWalkCallback)(DirEntry entry, void* context);
+
+/* dir */
+
+// Recursively list the entries under a directory that pass the filters in `options`,
+// reading directories in parallel on `options.num_threads` threads. Paths start with
+// `root`, and their memory is owned by the listing (free it with `dir_listing_free`).
+// The listing is empty if `root` couldn't be opened or memory ran out.
+DirListing dir_walk(str root, DirWalkOptions options);
+// Recursively walk the entries under a directory that pass the filters in `options`,
+// passing each one to `callback` along with `context`. This function will return false
+// if `root` couldn't be opened, if memory ran out, or if the callback stopped the walk.
+bool       dir_walk_each(str root, DirWalkOptions options, DirWalkCallback callback, void* context);
+// Free a directory listing's paths.
+void       dir_listing_free(DirListing* listing);
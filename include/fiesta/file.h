@@ -6,6 +6,7 @@
 #include <sys/types.h>
 #endif
 
+#include "hash.h"
 #include "str.h"
 
 typedef enum {
@@ -16,26 +17,99 @@ typedef enum {
     FileRead         = 0b0000'1000,
     FileWrite        = 0b0001'0000,
     FileAppend       = 0b0010'0000,
+    FileDirect       = 0b0100'0000,
     FileAll          = 0b0011'1111
 } FileAccessModes;
 
+typedef struct {
+    //\ -1 if the metadata couldn't be queried.
+    int64_t size;
+    int64_t modified_time;
+    int64_t block_size;
+    uint64_t inode;
+    uint64_t device;
+    bool is_regular;
+    bool is_directory;
+} FileStat;
+
 typedef struct {
     FILE* ptr;
     int64_t position;
     FileAccessModes access_modes;
+    FileStat stat;
+    bool stat_cached;
+    int direct_fd;
+    //\ Updated with every byte read or written through the
+    //\ file's position (but not by positional IO).
+    Hasher* hasher;
+#ifdef _WIN32
+    //\ A second handle for positional IO, opened for overlapped
+    //\ IO on first use so that `ptr`'s position isn't moved.
+    void* overlapped_handle;
+#endif
 } File;
 
+typedef enum {
+    FileHintNormal,
+    FileHintSequential,
+    FileHintRandom,
+    FileHintWillNeed,
+    FileHintDontNeed,
+    FileHintNoReuse
+} FileAccessHint;
+
 typedef enum {
     FilePositionStart   = SEEK_SET,
     FilePositionCurrent = SEEK_CUR,
     FilePositionEnd     = SEEK_END
 } FilePositionOrigin;
 
+typedef struct {
+    File file;
+    dynstr filename;
+    //\ Bytes read but not yet returned as lines, starting
+    //\ at `partial_start`. The file is read straight into
+    //\ its spare capacity.
+    dynstr partial;
+    int partial_start;
+#ifdef __linux__
+    int inotify_fd;
+    int file_watch;
+    int dir_watch;
+#elifdef _WIN32
+    //\ The followed file's directory, opened for overlapped
+    //\ IO, and its pending ReadDirectoryChangesW request.
+    void* dir_handle;
+    void* dir_watch;
+#endif
+} FileFollower;
+
+typedef struct {
+    //\ Line `i * interval` (counting from 0) starts at
+    //\ byte `checkpoints.data[i]`.
+    Vec(int64_t) checkpoints;
+    int interval;
+    //\ How much of the file has been indexed, the number
+    //\ of newlines in it and where the line after the
+    //\ last of them starts.
+    int64_t indexed_size;
+    int64_t num_newlines;
+    int64_t last_line_start;
+    //\ Identity of the indexed file.
+    uint64_t inode;
+    uint64_t device;
+} FileLineIndex;
+
+DEFINE_OPTIONAL(FileLineIndex)
+
 /* file */
 
 // Open a file with the specified file access mode (modes are
 // selected by bitwise OR'ing FileAccessModes values together;
 // e.g. `FileRead | FileWrite` selects the "r+" access mode).
+// `FileDirect` additionally opens the file for unbuffered (O_DIRECT)
+// reads, which `file_read_all` uses to stream large files without
+// going through the page cache. It is ignored if unsupported.
 File    file_open(str filename, FileAccessModes access_modes);
 // Check whether a file is open.
 bool    file_is_open(File file);
@@ -45,19 +119,43 @@ void    file_close(File* file);
 bool    file_seek(File* file, int64_t offset, FilePositionOrigin origin);
 // Rewind a file back to its start.
 void    file_rewind(File* file);
-// Get a file's length.
+// Get a file's length, or -1 if it couldn't be queried. This always queries the
+// file's current metadata.
 int64_t file_get_length(File* file);
 // Get a file's current position.
 int64_t file_get_position(File file);
+// Get a file's metadata (size, modification time, etc.). The metadata
+// is queried once and then cached until the file is written to.
+FileStat file_stat(File* file);
+// Query a file's metadata again, replacing any cached metadata. If the metadata
+// couldn't be queried, its size is -1 and nothing is cached.
+FileStat file_refresh_stat(File* file);
+// Hint to the OS how a range of a file will be accessed, so that it can
+// tune readahead and caching. A `length` of 0 extends the range to the end
+// of the file. Returns false if the hint couldn't be applied.
+bool    file_advise(File* file, FileAccessHint hint, int64_t offset, int64_t length);
+// Attach a streaming hasher to a file, so that the bytes read by `file_read_*` and written
+// by `file_write_*` update it as they pass through (e.g. to verify a file while ingesting it).
+// Positional reads and writes don't update it. Pass NULL to detach the hasher.
+void    file_attach_hasher(File* file, Hasher* hasher);
 
-// Read a string (up to `size` in length) from a file.
+// Read a string (up to `size` in length) from a file. If the string couldn't be
+// allocated, its data is NULL and errno is set to ENOMEM.
 str      file_read_str(File* file, int64_t size);
+// Read the rest of a file (from its current position) into a string.
+// The string is allocated once, sized from the file's metadata. If it
+// couldn't be allocated, its data is NULL and errno is set to ENOMEM.
+str      file_read_all(File* file);
 // Read a string from a file until `delimiter` is found (or EOF is reached).
 str      file_read_until_delimiter(File* file, char delimiter);
 // Read a line from a file.
 str      file_read_line(File* file);
 // Read the lines (each line being up to `max_line_length` in length) from a file.
 str_arr  file_read_lines(File* file, int64_t max_line_length);
+// Read the lines (of any length) from a file into a packed string array. None is returned
+// if reading or allocating failed, or if the lines don't fit in a packed string array
+// (which holds up to `INT_MAX` bytes).
+Optional(str_pack) file_read_lines_packed(File* file);
 // Read `count` signed 8-bit integers from a file. This function will return the
 // total number of integers read if successful, or -1 if there was an error. The
 // caller is expected to allocate enough space in `buffer` to hold the read integers.
@@ -168,3 +266,190 @@ ssize_t file_write_f64(File* file, double* data, size_t count);
              float*:    file_write_f32, \
              double*:   file_write_f64  \
     )(file,data,count)
+
+// Read a string (up to `size` in length) from a file, starting at `offset`. Positional
+// reads and writes neither use nor move the file's position and take no locks, so many
+// threads can use them on the same file at once. If the string couldn't be allocated
+// (or `size` is negative), its data is NULL and errno is set to ENOMEM.
+str     file_pread_str(File* file, int64_t offset, int64_t size);
+// Read `count` signed 8-bit integers from a file, starting at `offset`, without moving
+// the file's position. This function will return the total number of integers read
+// if successful, or -1 if there was an error. The caller is expected to allocate
+// enough space in `buffer` to hold the read integers.
+ssize_t file_pread_i8(File* file, int64_t offset, int8_t* buffer, size_t count);
+// Read `count` unsigned 8-bit integers from a file, starting at `offset`, without moving
+// the file's position. This function will return the total number of integers read
+// if successful, or -1 if there was an error. The caller is expected to allocate
+// enough space in `buffer` to hold the read integers.
+ssize_t file_pread_u8(File* file, int64_t offset, uint8_t* buffer, size_t count);
+// Read `count` signed 16-bit integers from a file, starting at `offset`, without moving
+// the file's position. This function will return the total number of integers read
+// if successful, or -1 if there was an error. The caller is expected to allocate
+// enough space in `buffer` to hold the read integers.
+ssize_t file_pread_i16(File* file, int64_t offset, int16_t* buffer, size_t count);
+// Read `count` unsigned 16-bit integers from a file, starting at `offset`, without moving
+// the file's position. This function will return the total number of integers read
+// if successful, or -1 if there was an error. The caller is expected to allocate
+// enough space in `buffer` to hold the read integers.
+ssize_t file_pread_u16(File* file, int64_t offset, uint16_t* buffer, size_t count);
+// Read `count` signed 32-bit integers from a file, starting at `offset`, without moving
+// the file's position. This function will return the total number of integers read
+// if successful, or -1 if there was an error. The caller is expected to allocate
+// enough space in `buffer` to hold the read integers.
+ssize_t file_pread_i32(File* file, int64_t offset, int32_t* buffer, size_t count);
+// Read `count` unsigned 32-bit integers from a file, starting at `offset`, without moving
+// the file's position. This function will return the total number of integers read
+// if successful, or -1 if there was an error. The caller is expected to allocate
+// enough space in `buffer` to hold the read integers.
+ssize_t file_pread_u32(File* file, int64_t offset, uint32_t* buffer, size_t count);
+// Read `count` signed 64-bit integers from a file, starting at `offset`, without moving
+// the file's position. This function will return the total number of integers read
+// if successful, or -1 if there was an error. The caller is expected to allocate
+// enough space in `buffer` to hold the read integers.
+ssize_t file_pread_i64(File* file, int64_t offset, int64_t* buffer, size_t count);
+// Read `count` unsigned 64-bit integers from a file, starting at `offset`, without moving
+// the file's position. This function will return the total number of integers read
+// if successful, or -1 if there was an error. The caller is expected to allocate
+// enough space in `buffer` to hold the read integers.
+ssize_t file_pread_u64(File* file, int64_t offset, uint64_t* buffer, size_t count);
+// Read `count` 32-bit floating point numbers from a file, starting at `offset`, without moving
+// the file's position. This function will return the total number of numbers read
+// if successful, or -1 if there was an error. The caller is expected to allocate
+// enough space in `buffer` to hold the read numbers.
+ssize_t file_pread_f32(File* file, int64_t offset, float* buffer, size_t count);
+// Read `count` 64-bit floating point numbers from a file, starting at `offset`, without moving
+// the file's position. This function will return the total number of numbers read
+// if successful, or -1 if there was an error. The caller is expected to allocate
+// enough space in `buffer` to hold the read numbers.
+ssize_t file_pread_f64(File* file, int64_t offset, double* buffer, size_t count);
+// Read `count` integers / floating point numbers from a file, starting at `offset`, without
+// moving the file's position. The function will return the total number of integers / numbers
+// read if successful, or -1 if there was an error. The caller is expected to allocate enough
+// space in `buffer` to hold the read numbers. This is a macro that infers the type of the
+// numbers being read.
+#define file_pread(file,offset,buffer,count) \
+    _Generic((buffer),                       \
+             void*:     file_pread_u8,       \
+             bool*:     file_pread_u8,       \
+             int8_t*:   file_pread_i8,       \
+             uint8_t*:  file_pread_u8,       \
+             int16_t*:  file_pread_i16,      \
+             uint16_t*: file_pread_u16,      \
+             int32_t*:  file_pread_i32,      \
+             uint32_t*: file_pread_u32,      \
+             int64_t*:  file_pread_i64,      \
+             uint64_t*: file_pread_u64,      \
+             float*:    file_pread_f32,      \
+             double*:   file_pread_f64       \
+    )(file,offset,buffer,count)
+
+// Write a string to a file, starting at `offset`, without moving the file's position. Data
+// buffered by `file_write_*` isn't flushed first, and in `FileAppend` mode the string is
+// appended regardless of `offset`. This function will return the number of bytes written
+// if successful, or -1 if there was an error.
+ssize_t file_pwrite_str(File* file, int64_t offset, str string);
+// Write `count` signed 8-bit integers to a file, starting at `offset`, without moving the
+// file's position. This function will return the total number of integers written if
+// successful, or -1 if there was an error.
+ssize_t file_pwrite_i8(File* file, int64_t offset, int8_t* data, size_t count);
+// Write `count` unsigned 8-bit integers to a file, starting at `offset`, without moving the
+// file's position. This function will return the total number of integers written if
+// successful, or -1 if there was an error.
+ssize_t file_pwrite_u8(File* file, int64_t offset, uint8_t* data, size_t count);
+// Write `count` signed 16-bit integers to a file, starting at `offset`, without moving the
+// file's position. This function will return the total number of integers written if
+// successful, or -1 if there was an error.
+ssize_t file_pwrite_i16(File* file, int64_t offset, int16_t* data, size_t count);
+// Write `count` unsigned 16-bit integers to a file, starting at `offset`, without moving the
+// file's position. This function will return the total number of integers written if
+// successful, or -1 if there was an error.
+ssize_t file_pwrite_u16(File* file, int64_t offset, uint16_t* data, size_t count);
+// Write `count` signed 32-bit integers to a file, starting at `offset`, without moving the
+// file's position. This function will return the total number of integers written if
+// successful, or -1 if there was an error.
+ssize_t file_pwrite_i32(File* file, int64_t offset, int32_t* data, size_t count);
+// Write `count` unsigned 32-bit integers to a file, starting at `offset`, without moving the
+// file's position. This function will return the total number of integers written if
+// successful, or -1 if there was an error.
+ssize_t file_pwrite_u32(File* file, int64_t offset, uint32_t* data, size_t count);
+// Write `count` signed 64-bit integers to a file, starting at `offset`, without moving the
+// file's position. This function will return the total number of integers written if
+// successful, or -1 if there was an error.
+ssize_t file_pwrite_i64(File* file, int64_t offset, int64_t* data, size_t count);
+// Write `count` unsigned 64-bit integers to a file, starting at `offset`, without moving the
+// file's position. This function will return the total number of integers written if
+// successful, or -1 if there was an error.
+ssize_t file_pwrite_u64(File* file, int64_t offset, uint64_t* data, size_t count);
+// Write `count` 32-bit floating point numbers to a file, starting at `offset`, without moving the
+// file's position. This function will return the total number of numbers written if
+// successful, or -1 if there was an error.
+ssize_t file_pwrite_f32(File* file, int64_t offset, float* data, size_t count);
+// Write `count` 64-bit floating point numbers to a file, starting at `offset`, without moving the
+// file's position. This function will return the total number of numbers written if
+// successful, or -1 if there was an error.
+ssize_t file_pwrite_f64(File* file, int64_t offset, double* data, size_t count);
+// Write `count` integers / floating point numbers to a file, starting at `offset`, without
+// moving the file's position. The function will return the total number of integers / numbers
+// written if successful, or -1 if there was an error. This is a macro that infers the type of
+// the numbers being written.
+#define file_pwrite(file,offset,data,count) \
+    _Generic((data),                        \
+             void*:     file_pwrite_u8,     \
+             bool*:     file_pwrite_u8,     \
+             int8_t*:   file_pwrite_i8,     \
+             uint8_t*:  file_pwrite_u8,     \
+             int16_t*:  file_pwrite_i16,    \
+             uint16_t*: file_pwrite_u16,    \
+             int32_t*:  file_pwrite_i32,    \
+             uint32_t*: file_pwrite_u32,    \
+             int64_t*:  file_pwrite_i64,    \
+             uint64_t*: file_pwrite_u64,    \
+             float*:    file_pwrite_f32,    \
+             double*:   file_pwrite_f64     \
+    )(file,offset,data,count)
+
+/* follow */
+
+// Follow a file that is being appended to (like `tail -F`), starting from its end if
+// `from_end` is true. The file doesn't need to exist yet. Truncation and rotation (the
+// file being replaced by a new one at the same path) are detected, and the new file is
+// read from its start. If the old file ended partway through a line, that line is still
+// returned, on its own.
+FileFollower file_follow(str filename, bool from_end);
+// Read the next complete line (without its newline) from a followed file, waiting up to
+// `timeout_ms` milliseconds for one to be appended (or forever if `timeout_ms` is -1).
+// Waiting is done with inotify (or ReadDirectoryChangesW on Windows) rather than polling,
+// though changes are also polled for every 100 ms on Windows, or on Linux if the file or
+// its directory couldn't be watched. None is returned on timeout, or with errno set to
+// ENOMEM if memory runs out.
+Optional(str) file_follow_read_line(FileFollower* follower, int timeout_ms);
+// Stop following a file.
+void    file_follow_close(FileFollower* follower);
+
+/* line index */
+
+// Index the lines of a file by recording where every `interval`th line starts (0 selects
+// 1024), so that any line can be found by scanning at most `interval` lines. The file is
+// scanned for newlines with positional reads and SIMD, leaving its position unchanged.
+FileLineIndex file_line_index_build(File* file, int interval);
+// Bring a line index up to date with its file. Files are assumed to only be appended to,
+// so only the bytes past the end of the index are scanned; if the file was replaced or
+// truncated, it is indexed again from the start. Returns false if reading failed.
+bool    file_line_index_update(File* file, FileLineIndex* index);
+// Get the number of lines in the indexed part of a file, counting a final line without
+// a newline.
+int64_t file_line_index_count(FileLineIndex* index);
+// Save a line index to a sidecar file at `path`, replacing it if it exists.
+bool    file_line_index_save(FileLineIndex* index, str path);
+// Load a line index saved by `file_line_index_save`, which should then be brought up to
+// date with `file_line_index_update`. None is returned if the sidecar file couldn't be
+// read or is corrupt.
+Optional(FileLineIndex) file_line_index_load(str path);
+// Free a line index.
+void    file_line_index_free(FileLineIndex* index);
+// Seek to the start of line `line` (counting from 0), by seeking to the nearest checkpoint
+// before it and scanning forward. Returns false if the line is past the end of the index.
+bool    file_seek_line(File* file, FileLineIndex* index, int64_t line);
+// Read line `line` (counting from 0, without its newline), leaving the file positioned at
+// the start of the next line. None is returned if the line is past the end of the index.
+Optional(str) file_read_line_at(File* file, FileLineIndex* index, int64_t line);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    HashCrc32c,
+    HashXxh64
+} HashAlgorithm;
+
+typedef struct {
+    HashAlgorithm algorithm;
+    uint64_t seed;
+    uint32_t crc;
+    //\ XXH64 accumulators, and the bytes of a partial
+    //\ 32-byte stripe waiting for more input.
+    uint64_t acc[4];
+    uint64_t total_len;
+    uint8_t stripe[32];
+    int stripe_len;
+} Hasher;
+
+/* hash */
+
+// Compute the CRC32C (Castagnoli) checksum of `len` bytes, using the SSE4.2
+// `crc32` instruction when the CPU supports it.
+uint32_t hash_crc32c_bytes(void* data, size_t len);
+// Continue a CRC32C checksum with `len` more bytes. Pass 0 as `crc` to start
+// a new checksum; `hash_crc32c_bytes(data, len)` is `hash_crc32c_update(0, data, len)`.
+uint32_t hash_crc32c_update(uint32_t crc, void* data, size_t len);
+// Compute the CRC32C checksum of a `str` or `dynstr`.
+#define  hash_crc32c(string) hash_crc32c_bytes((string).data, (string).len)
+// Compute the 64-bit XXH64 hash of `len` bytes. This is a fast non-cryptographic
+// hash suitable for hash tables and change detection.
+uint64_t hash_xxh64_bytes(void* data, size_t len, uint64_t seed);
+// Compute the 64-bit XXH64 hash of a `str` or `dynstr`.
+#define  hash_xxh64(string,seed) hash_xxh64_bytes((string).data, (string).len, seed)
+
+/* hasher */
+
+// Create a streaming hasher, which produces the same digest as hashing all of
+// the bytes passed to it at once. `seed` is ignored by CRC32C hashers.
+Hasher   hasher_create(HashAlgorithm algorithm, uint64_t seed);
+// Pass `len` more bytes through a hasher.
+void     hasher_update(Hasher* hasher, void* data, size_t len);
+// Get the digest of the bytes passed through a hasher so far (CRC32C digests
+// are zero-extended). The hasher can continue to be updated afterwards.
+uint64_t hasher_digest(Hasher* hasher);
+// Reset a hasher back to its state when it was created.
+void     hasher_reset(Hasher* hasher);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "file.h"
+#include "optional.h"
+#include "str.h"
+
+typedef struct {
+    //\ A batch of records is committed once it holds at least
+    //\ `max_batch_bytes` bytes, or once its oldest record has
+    //\ waited `max_latency_us` microseconds. Records appended
+    //\ while a batch is being committed join the next batch.
+    int64_t max_batch_bytes;
+    int64_t max_latency_us;
+    //\ Appends block while the next batch already holds this
+    //\ many bytes (0 uses 4 * `max_batch_bytes`), so that a
+    //\ slow commit can't make it grow without bound. A record
+    //\ is always accepted into an empty batch.
+    int64_t max_pending_bytes;
+} JournalOptions;
+
+typedef struct Journal Journal;
+
+/* journal */
+
+// Open an append-only journal, creating its file if needed. Records appended from any
+// number of threads are framed (with a length prefix and CRC32C checksum) and coalesced
+// into batches, and each batch is committed with a single write and `fdatasync` (or
+// `FlushFileBuffers` on Windows). This function will return NULL if the file couldn't be
+// opened.
+Journal* journal_open(str filename, JournalOptions options);
+// Append a record to a journal, returning a ticket that can be passed to `journal_wait`.
+// The record is copied, and isn't durable until its batch has been committed. This
+// function blocks while the pending batch is full. If the record can't be added to the
+// batch (it is too large or memory runs out), the whole batch fails to commit.
+uint64_t journal_append(Journal* journal, str record);
+// Block until the record with `ticket` is durable. This function will return false if
+// the journal failed to commit it (after which every later commit fails as well).
+bool     journal_wait(Journal* journal, uint64_t ticket);
+// Check whether the record with `ticket` is durable, without blocking.
+bool     journal_is_durable(Journal* journal, uint64_t ticket);
+// Get how many bytes of framed records are waiting for the next commit.
+int64_t  journal_pending_bytes(Journal* journal);
+// Append a record to a journal and block until it is durable.
+bool     journal_append_sync(Journal* journal, str record);
+// Commit any pending records, then close a journal and free its memory. This function
+// will return false if any commit failed.
+bool     journal_close(Journal* journal);
+// Read the next record from a journal file. None is returned at the end of the file, or
+// if the record is incomplete or its checksum doesn't match (as with a torn final write).
+Optional(str) journal_read_record(File* file);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "file.h"
+#include "str.h"
+#include "vec.h"
+
+typedef enum {
+    MatcherDefault         = 0b0000'0000,
+    MatcherCaseInsensitive = 0b0000'0001
+} MatcherOptions;
+
+typedef struct {
+    int pattern_id;
+    int len;
+    int64_t offset;
+} Match;
+
+DEFINE_VEC(Match)
+
+typedef Vec(Match) match_arr;
+
+//\ A cell in the double-array trie. A transition from state `s`
+//\ on byte `c` exists if `cells[cells[s].base + c].check == s`.
+typedef struct {
+    int32_t base;
+    int32_t check;
+} MatcherCell;
+
+typedef struct {
+    MatcherCell* cells;
+    //\ Per-cell failure links, first pattern IDs ending at the
+    //\ cell (or -1), and the next cell with output along the
+    //\ failure chain (or -1).
+    int32_t* fail;
+    int32_t* output;
+    int32_t* output_link;
+    //\ Links between patterns that are identical (or -1).
+    int32_t* pattern_next;
+    int* pattern_lens;
+    int num_cells;
+    int num_patterns;
+    uint8_t fold[256];
+} Matcher;
+
+typedef struct {
+    Matcher* matcher;
+    int32_t state;
+    int64_t offset;
+} MatchStream;
+
+/* matcher */
+
+// Compile a multi-pattern matcher (an Aho-Corasick automaton stored as a double-array
+// trie) from an array of patterns. Each pattern's ID is its index in `patterns`. Empty
+// patterns never match. Options are selected by bitwise OR'ing MatcherOptions values
+// together (e.g. `MatcherCaseInsensitive` enables ASCII case-insensitive matching). If
+// memory couldn't be allocated, an invalid matcher that never matches is returned.
+Matcher   matcher_create(str_arr patterns, MatcherOptions options);
+// Check whether a matcher was created successfully.
+bool      matcher_is_valid(Matcher matcher);
+// Free a matcher's data.
+void      matcher_free(Matcher* matcher);
+// Find every occurrence of every pattern in a string. Matches are ordered by where they
+// end, and each match's offset is the index in `text` where it starts.
+match_arr matcher_find_all(Matcher* matcher, str text);
+// Check whether any pattern occurs in a string.
+bool      matcher_contains_any(Matcher* matcher, str text);
+// Create a stream for matching text that arrives in chunks (e.g. from `file_read_*` calls).
+MatchStream matcher_stream_create(Matcher* matcher);
+// Feed the next chunk of text to a stream, appending its matches to `matches`. Matches
+// may span multiple chunks, and their offsets count from the start of the stream.
+void      matcher_stream_feed(MatchStream* stream, str chunk, match_arr* matches);
+// Find every occurrence of every pattern in a file, from its current position to its end.
+// Match offsets are absolute positions in the file.
+match_arr matcher_find_all_in_file(Matcher* matcher, File* file);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "str.h"
+
+#define RING_CACHE_LINE 64
+
+typedef enum {
+    RingSpsc,
+    RingMpsc,
+    RingSpmc
+} RingMode;
+
+//\ A slot is ready to be pushed to when its sequence equals the
+//\ position being pushed, and ready to be popped from when its
+//\ sequence is one past the position being popped.
+typedef struct {
+    _Atomic uint64_t sequence;
+    str value;
+} RingSlot;
+
+typedef struct {
+    //\ The next positions to push to and pop from, each on
+    //\ its own cache line so producers and consumers don't
+    //\ contend over them.
+    alignas(RING_CACHE_LINE) _Atomic uint64_t tail;
+    alignas(RING_CACHE_LINE) _Atomic uint64_t head;
+    //\ Futex words that are bumped when the ring stops being
+    //\ empty / full, if any threads are waiting for that.
+    alignas(RING_CACHE_LINE) _Atomic uint32_t not_empty;
+    _Atomic uint32_t empty_waiters;
+    alignas(RING_CACHE_LINE) _Atomic uint32_t not_full;
+    _Atomic uint32_t full_waiters;
+    alignas(RING_CACHE_LINE) RingSlot* slots;
+    uint64_t mask;
+    RingMode mode;
+    atomic_bool closed;
+} Ring;
+
+/* ring */
+
+// Create a lock-free bounded ring buffer of strings. `capacity` is rounded up to a power
+// of two. `RingSpsc` rings support one producer thread and one consumer thread, `RingMpsc`
+// rings support any number of producers, and `RingSpmc` rings support any number of
+// consumers. Ownership of each string's memory passes from producer to consumer.
+Ring* ring_create(int capacity, RingMode mode);
+// Free a ring buffer. Any strings still in it are not freed.
+void  ring_free(Ring* ring);
+// Push a string to a ring buffer without blocking, returning false if it is full.
+bool  ring_try_push(Ring* ring, str value);
+// Push up to `count` strings to a ring buffer without blocking, returning how many were pushed.
+int   ring_try_push_n(Ring* ring, str* values, int count);
+// Pop a string from a ring buffer without blocking, returning false if it is empty.
+bool  ring_try_pop(Ring* ring, str* value);
+// Pop up to `max_count` strings from a ring buffer without blocking, returning how many were popped.
+int   ring_try_pop_n(Ring* ring, str* values, int max_count);
+// Push a string to a ring buffer, waiting (on a futex) while it is full. This function
+// will return false if the ring was closed.
+bool  ring_push(Ring* ring, str value);
+// Push `count` strings to a ring buffer, waiting while it is full. This function will return
+// how many strings were pushed, which is less than `count` if the ring was closed.
+int   ring_push_n(Ring* ring, str* values, int count);
+// Pop a string from a ring buffer, waiting (on a futex) while it is empty. This function
+// will return false if the ring was closed and has been emptied.
+bool  ring_pop(Ring* ring, str* value);
+// Pop up to `max_count` strings from a ring buffer, waiting while it is empty. This function
+// will return how many strings were popped, which is 0 if the ring was closed and has been emptied.
+int   ring_pop_n(Ring* ring, str* values, int max_count);
+// Close a ring buffer, waking every waiting thread. Pushes fail once a ring is closed,
+// but the strings already in it can still be popped.
+void  ring_close(Ring* ring);
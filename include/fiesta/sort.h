@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "file.h"
+#include "str.h"
+
+typedef struct {
+    //\ Every option is defaulted when left zeroed, so
+    //\ `(SortOptions){0}` sorts whole lines bytewise
+    //\ (like `LC_ALL=C sort`) in 256 MiB of memory.
+    //\ The budget covers the lines being sorted (along
+    //\ with their sort records and scratch space) and
+    //\ the merge buffers, and is shared between threads.
+    int64_t memory_budget;
+    //\ 0 uses one thread per online CPU.
+    int num_threads;
+    //\ Sort by the `key_field`th field (counting from 1)
+    //\ of each line, with fields separated by
+    //\ `key_delimiter`. Lines without that field have an
+    //\ empty key. 0 sorts by whole lines. Lines with equal
+    //\ keys are ordered by the whole line.
+    int key_field;
+    char key_delimiter;
+    //\ Only output the first line with each key.
+    bool unique;
+    //\ Directory for temporary run files ($TMPDIR or /tmp
+    //\ if empty, or GetTempPath's directory on Windows).
+    str temp_dir;
+} SortOptions;
+
+/* sort */
+
+// Sort the lines of `input` (from its current position) into `output`, using a bounded amount
+// of memory so that files larger than memory can be sorted. Lines are read in chunks that are
+// sorted in parallel on `options.num_threads` threads and written to temporary run files, which
+// are then merged with a k-way heap merge. Every output line ends with a newline. This function
+// will return false if a temporary file couldn't be created, or if reading or writing failed.
+bool sort_lines(File* input, File* output, SortOptions options);
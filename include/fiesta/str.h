@@ -3,22 +3,41 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "optional.h"
+#include "vec.h"
+
 typedef struct {
     char* data;
     int len;
 } str;
 
-typedef struct {
-    char* data;
-    int len;
-    int cap;
-} dynstr;
+DEFINE_OPTIONAL(str)
+DEFINE_VEC(str)
+
+//\ Dynamic strings and string arrays are vectors, so
+//\ the `vec_char_*` and `vec_str_*` functions can be
+//\ used on them as well (e.g. to reserve capacity),
+//\ though a dynamic string's data must be kept
+//\ null-terminated.
+typedef Vec(char) dynstr;
+typedef Vec(str) str_arr;
+
+typedef enum {
+    //\ A-Z a-z 0-9 + / with '=' padding (RFC 4648 section 4).
+    Base64Standard,
+    //\ A-Z a-z 0-9 - _ without padding (RFC 4648 section 5).
+    Base64Url
+} Base64Alphabet;
 
 typedef struct {
-    str* data;
-    int len;
-    int cap;
-} str_arr;
+    //\ Every string's bytes (each null-terminated), back to
+    //\ back, and the offset in `bytes` where each one starts.
+    dynstr bytes;
+    Vec(uint32_t) offsets;
+} str_pack;
+
+DEFINE_OPTIONAL(str_pack)
+DEFINE_OPTIONAL(str_arr)
 
 /* str */
 
@@ -56,12 +75,15 @@ dynstr dynstr_create_from(char* text);
 #define DSTR(string) dynstr_create_from(string)
 // Free a dynamic string's data.
 void   dynstr_free(dynstr string);
-// Append data to a dynamic string from a null-terminated source.
-void   dynstr_append(dynstr* string, char* text);
-// Append data to a dynamic string from another dynamic string.
-void   dynstr_append_str(dynstr* string, str text);
-// Append a character to a dynamic-length string.
-void   dynstr_append_char(dynstr* string, char c);
+// Append data to a dynamic string from a null-terminated source. Returns false (leaving
+// the string unchanged) if memory couldn't be allocated.
+bool   dynstr_append(dynstr* string, char* text);
+// Append data to a dynamic string from another dynamic string. Returns false (leaving
+// the string unchanged) if memory couldn't be allocated.
+bool   dynstr_append_str(dynstr* string, str text);
+// Append a character to a dynamic-length string. Returns false (leaving the string
+// unchanged) if memory couldn't be allocated.
+bool   dynstr_append_char(dynstr* string, char c);
 // Remove characters from the range [start, end) in a dynamic string.
 void   dynstr_remove(dynstr* string, int start, int end);
 // Clear a dynamic string's data.
@@ -102,4 +124,55 @@ str     str_arr_remove(str_arr* arr, int index);
 // Print the contents of a string array.
 void    str_arr_print(str_arr arr);
 // Join together a string array's elements into one string, with an optional separator between elements. Pass `NULL` as the separator if one is not desired. The string array's memory will be freed.
-str     str_arr_to_str(str_arr* arr, str* separator, bool free_elements);
\ No newline at end of file
+str     str_arr_to_str(str_arr* arr, str* separator, bool free_elements);
+
+/* str_pack */
+
+// Create a packed array of strings, which stores every string's bytes in one contiguous
+// block of memory instead of allocating each string separately.
+str_pack str_pack_create(void);
+// Free a packed string array's data.
+void     str_pack_free(str_pack pack);
+// Get the number of strings in a packed string array.
+int      str_pack_len(str_pack pack);
+// Make room for `num_strings` more strings, totalling `num_bytes` bytes, in a packed string array.
+// This function will return false if the memory couldn't be allocated.
+bool     str_pack_reserve(str_pack* pack, int num_strings, int num_bytes);
+// Get a string from an index into a packed string array. The string points into the packed
+// array's memory, so it is only valid until the packed array is modified or freed.
+str      str_pack_get(str_pack pack, int index);
+// Append a copy of a string to a packed string array. This function will return false
+// (leaving the array unchanged) if the memory couldn't be allocated.
+bool     str_pack_append(str_pack* pack, str string);
+// Remove every string from a packed string array, without freeing its memory.
+void     str_pack_clear(str_pack* pack);
+// Print the contents of a packed string array.
+void     str_pack_print(str_pack pack);
+// Create a packed string array holding copies of a string array's elements. None is returned
+// if the memory couldn't be allocated.
+Optional(str_pack) str_pack_from_arr(str_arr arr);
+// Create a string array whose elements point into a packed string array's memory. The string
+// array must be freed with `str_arr_free` (not `str_arr_free_elements`), and is only valid
+// until the packed array is modified or freed. None is returned if the memory couldn't be
+// allocated.
+Optional(str_arr) str_pack_to_arr(str_pack pack);
+// Split a string at a delimiter, returning a packed array of the resulting strings. None is
+// returned if the memory couldn't be allocated.
+Optional(str_pack) str_split_packed(str src, char delimiter);
+
+/* encoding */
+
+// Append the base64 encoding of `src` to `dst`. The output is sized up front and written
+// with AVX2 / SSSE3 kernels when the CPU supports them. This function will return false if
+// the output couldn't be allocated.
+bool str_base64_encode(str src, Base64Alphabet alphabet, dynstr* dst);
+// Append the bytes decoded from base64 `src` to `dst`. Decoding is strict: characters outside
+// the alphabet (including whitespace), misplaced or missing padding, and non-zero trailing bits
+// are rejected. This function will return false (leaving `dst` unchanged) if `src` is invalid.
+bool str_base64_decode(str src, Base64Alphabet alphabet, dynstr* dst);
+// Append the lowercase hexadecimal encoding of `src` to `dst`. This function will return
+// false if the output couldn't be allocated.
+bool str_hex_encode(str src, dynstr* dst);
+// Append the bytes decoded from hexadecimal `src` (in either case) to `dst`. This function
+// will return false (leaving `dst` unchanged) if `src` has an odd length or a non-hex character.
+bool str_hex_decode(str src, dynstr* dst);
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <sys/types.h>
+#ifdef _MSC_VER
+// MinGW's sys/types.h defines ssize_t, but the MSVC runtime's doesn't
+#include <BaseTsd.h>
+typedef SSIZE_T ssize_t;
+#endif
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+//\ Capacity of a vector's first allocation. Every
+//\ following allocation doubles the capacity, so
+//\ capacities are always powers of two.
+#define VEC_BASE_CAP 8
+
+/* Vec */
+
+// Dynamic array type holding elements of `type` (must be defined using `DEFINE_VEC`).
+#define Vec(type) Vec_##type
+// Name of the function `name` generated by `DEFINE_VEC` for `type` (e.g. `VEC_FN(int, push)` is `vec_int_push`).
+#define VEC_FN(type,name) vec_##type##_##name
+
+// Define a dynamic array type for `type`, along with the following functions (where `T` is `type`):
+// `vec_T_create()` creates an empty vector without allocating,
+// `vec_T_free(vec)` frees a vector's data,
+// `vec_T_reserve(vec*, n)` makes room for at least `n` more elements,
+// `vec_T_shrink_to_fit(vec*)` reduces a vector's capacity to its length,
+// `vec_T_push(vec*, item)` appends an element,
+// `vec_T_push_n(vec*, items*, n)` appends `n` elements from an array,
+// `vec_T_insert(vec*, index, item)` inserts an element before `index`,
+// `vec_T_remove(vec*, index)` removes and returns the element at an in-bounds `index`, preserving order,
+// `vec_T_swap_remove(vec*, index)` removes and returns the element at an in-bounds `index` by moving the last element into its place,
+// `vec_T_extend(vec*, other)` appends every element of another vector, and
+// `vec_T_clear(vec*)` removes every element without freeing.
+// Growth is amortized by doubling, and newly allocated memory is not zeroed.
+// `reserve`, `push`, `push_n`, `insert` and `extend` return false if allocation failed.
+#define DEFINE_VEC(type)                                                          \
+    typedef struct {                                                              \
+        type* data;                                                               \
+        int len;                                                                  \
+        int cap;                                                                  \
+    } Vec(type);                                                                  \
+                                                                                  \
+    static inline Vec(type) vec_##type##_create(void) {                           \
+        return (Vec(type)){0};                                                    \
+    }                                                                             \
+                                                                                  \
+    static inline void vec_##type##_free(Vec(type) vec) {                         \
+        free(vec.data);                                                           \
+    }                                                                             \
+                                                                                  \
+    static inline bool vec_##type##_reserve(Vec(type)* vec, int n) {              \
+        if (n < 0 || n > INT_MAX - vec->len)                                      \
+            return false;                                                         \
+        if (vec->len + n <= vec->cap)                                             \
+            return true;                                                          \
+        int new_cap = vec->cap > 0 ? vec->cap : VEC_BASE_CAP;                     \
+        while (new_cap < vec->len + n) {                                          \
+            /* Saturate instead of overflowing */                                 \
+            if (new_cap > INT_MAX / 2) {                                          \
+                new_cap = vec->len + n;                                           \
+                break;                                                            \
+            }                                                                     \
+            new_cap *= 2;                                                         \
+        }                                                                         \
+        type* new_data = realloc(vec->data, (size_t)new_cap * sizeof(type));      \
+        if (new_data == NULL)                                                     \
+            return false;                                                         \
+        vec->data = new_data;                                                     \
+        vec->cap = new_cap;                                                       \
+        return true;                                                              \
+    }                                                                             \
+                                                                                  \
+    static inline void vec_##type##_shrink_to_fit(Vec(type)* vec) {               \
+        if (vec->len == vec->cap)                                                 \
+            return;                                                               \
+        /* Passing 0 to realloc would free the allocation */                      \
+        if (vec->len == 0) {                                                      \
+            free(vec->data);                                                      \
+            vec->data = NULL;                                                     \
+            vec->cap = 0;                                                         \
+            return;                                                               \
+        }                                                                         \
+        type* new_data = realloc(vec->data, (size_t)vec->len * sizeof(type));     \
+        if (new_data == NULL)                                                     \
+            return;                                                               \
+        vec->data = new_data;                                                     \
+        vec->cap = vec->len;                                                      \
+    }                                                                             \
+                                                                                  \
+    static inline bool vec_##type##_push(Vec(type)* vec, type item) {             \
+        if (vec->len == vec->cap && !vec_##type##_reserve(vec, 1))                \
+            return false;                                                         \
+        vec->data[vec->len++] = item;                                             \
+        return true;                                                              \
+    }                                                                             \
+                                                                                  \
+    static inline bool vec_##type##_push_n(Vec(type)* vec, type* items, int n) {  \
+        if (n <= 0)                                                               \
+            return n == 0;                                                        \
+        /* `items` may point into the vector itself (e.g. when extending          \
+        a vector with itself), and reserving can move its data */                 \
+        uintptr_t start = (uintptr_t)vec->data;                                   \
+        uintptr_t end = start + (size_t)vec->len * sizeof(type);                  \
+        bool aliased = (uintptr_t)items >= start && (uintptr_t)items < end;       \
+        size_t offset = aliased ? ((uintptr_t)items - start) / sizeof(type) : 0;  \
+        if (!vec_##type##_reserve(vec, n))                                        \
+            return false;                                                         \
+        if (aliased)                                                              \
+            items = vec->data + offset;                                           \
+        memcpy(&vec->data[vec->len], items, (size_t)n * sizeof(type));            \
+        vec->len += n;                                                            \
+        return true;                                                              \
+    }                                                                             \
+                                                                                  \
+    static inline bool vec_##type##_insert(Vec(type)* vec, int index, type item) {\
+        if (index < 0 || index > vec->len)                                        \
+            return false;                                                         \
+        if (vec->len == vec->cap && !vec_##type##_reserve(vec, 1))                \
+            return false;                                                         \
+        memmove(                                                                  \
+            &vec->data[index + 1], &vec->data[index],                             \
+            (size_t)(vec->len - index) * sizeof(type)                             \
+        );                                                                        \
+        vec->data[index] = item;                                                  \
+        vec->len++;                                                               \
+        return true;                                                              \
+    }                                                                             \
+                                                                                  \
+    static inline type vec_##type##_remove(Vec(type)* vec, int index) {           \
+        type removed = vec->data[index];                                          \
+        memmove(                                                                  \
+            &vec->data[index], &vec->data[index + 1],                             \
+            (size_t)(vec->len - index - 1) * sizeof(type)                         \
+        );                                                                        \
+        vec->len--;                                                               \
+        return removed;                                                           \
+    }                                                                             \
+                                                                                  \
+    static inline type vec_##type##_swap_remove(Vec(type)* vec, int index) {      \
+        type removed = vec->data[index];                                          \
+        vec->data[index] = vec->data[--vec->len];                                 \
+        return removed;                                                           \
+    }                                                                             \
+                                                                                  \
+    static inline bool vec_##type##_extend(Vec(type)* vec, Vec(type) other) {     \
+        return vec_##type##_push_n(vec, other.data, other.len);                   \
+    }                                                                             \
+                                                                                  \
+    static inline void vec_##type##_clear(Vec(type)* vec) {                       \
+        vec->len = 0;                                                             \
+    }
+
+DEFINE_VEC(bool)
+DEFINE_VEC(short)
+DEFINE_VEC(char)
+DEFINE_VEC(long)
+DEFINE_VEC(int)
+DEFINE_VEC(size_t)
+DEFINE_VEC(ssize_t)
+DEFINE_VEC(int8_t)
+DEFINE_VEC(uint8_t)
+DEFINE_VEC(int16_t)
+DEFINE_VEC(uint16_t)
+DEFINE_VEC(int32_t)
+DEFINE_VEC(uint32_t)
+DEFINE_VEC(int64_t)
+DEFINE_VEC(uint64_t)
+DEFINE_VEC(float)
+DEFINE_VEC(double)
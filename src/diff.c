@@ -0,0 +1,500 @@
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "diff.h"
+#include "file.h"
+#include "hash.h"
+#include "str.h"
+#include "vec.h"
+
+#define DEFAULT_CONTEXT  3
+// Fewest edits searched for before settling for a script that may not be minimal
+#define MIN_COST_LIMIT   4096
+#define MIN_TABLE_SIZE   16
+#define WRITE_BUF_SIZE   65536
+
+typedef struct {
+    uint64_t hash;
+    str line;
+    //\ -1 if the slot is empty.
+    int id;
+} LineSlot;
+
+typedef struct {
+    //\ IDs of the lines being compared, which are the
+    //\ lines appearing on both sides, and the index of
+    //\ each one in the original lines.
+    int* old_ids;
+    int* new_ids;
+    int* old_index;
+    int* new_index;
+    //\ Furthest reaching paths for the forward and
+    //\ backward searches, by diagonal.
+    int* forward;
+    int* backward;
+    //\ Which of the original lines are changed.
+    bool* deleted;
+    bool* inserted;
+    //\ Most edits searched for in one range before the
+    //\ furthest point reached is used as the split.
+    int cost_limit;
+} DiffContext;
+
+typedef struct {
+    File* file;
+    dynstr buf;
+    bool ok;
+} DiffWriter;
+
+/* Give every distinct line an ID, so that lines are compared as integers.
+Returns the number of IDs given, or -1 if memory couldn't be allocated. */
+static int assign_ids(str_arr old_lines, str_arr new_lines, int* old_ids, int* new_ids) {
+    size_t table_size = MIN_TABLE_SIZE;
+    while (table_size < 2 * ((size_t)old_lines.len + new_lines.len))
+        table_size *= 2;
+    LineSlot* table = malloc(table_size * sizeof(LineSlot));
+    if (table == NULL)
+        return -1;
+    for (size_t i = 0; i < table_size; i++)
+        table[i].id = -1;
+
+    int num_ids = 0;
+    for (int side = 0; side < 2; side++) {
+        str_arr lines = side == 0 ? old_lines : new_lines;
+        int* ids = side == 0 ? old_ids : new_ids;
+        for (int i = 0; i < lines.len; i++) {
+            str line = lines.data[i];
+            uint64_t hash = hash_xxh64(line, 0);
+            size_t slot = hash & (table_size - 1);
+            while (table[slot].id != -1 && (table[slot].hash != hash || table[slot].line.len != line.len
+                                            || memcmp(table[slot].line.data, line.data, line.len) != 0))
+                slot = (slot + 1) & (table_size - 1);
+            if (table[slot].id == -1)
+                table[slot] = (LineSlot){.hash = hash, .line = line, .id = num_ids++};
+            ids[i] = table[slot].id;
+        }
+    }
+    free(table);
+    return num_ids;
+}
+
+/* Find where the middle snake of the shortest edit script between
+old_ids[old_lo, old_hi) and new_ids[new_lo, new_hi) is, by searching
+forwards from the start and backwards from the end until the paths
+overlap. If that takes too many edits, the point that either search
+got furthest to is used instead, like `diff` does without `--minimal`,
+so that very different inputs don't take quadratic time. Returns false
+if nothing is in common. */
+static bool find_split(DiffContext* ctx, int old_lo, int old_hi, int new_lo, int new_hi,
+                       int* split_old, int* split_new) {
+    int* a = ctx->old_ids + old_lo;
+    int* b = ctx->new_ids + new_lo;
+    int n = old_hi - old_lo;
+    int m = new_hi - new_lo;
+    int max_d = (n + m + 1) / 2;
+    int offset = max_d;
+    int v_len = 2 * max_d + 2;
+    int* v1 = ctx->forward;
+    int* v2 = ctx->backward;
+    for (int i = 0; i < v_len; i++) {
+        v1[i] = -1;
+        v2[i] = -1;
+    }
+    v1[offset + 1] = 0;
+    v2[offset + 1] = 0;
+    int delta = n - m;
+    // The paths meet in the forward search if the difference in lengths is odd
+    bool front = delta % 2 != 0;
+    // Diagonals that have run off the edge are skipped
+    int k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+    int best_forward = 0, best_forward_x = 0, best_forward_y = 0;
+    int best_backward = 0, best_backward_x = 0, best_backward_y = 0;
+    for (int d = 0; d < max_d; d++) {
+        if (d >= ctx->cost_limit) {
+            if (best_forward >= best_backward) {
+                *split_old = best_forward_x;
+                *split_new = best_forward_y;
+            }
+            else {
+                *split_old = n - best_backward_x;
+                *split_new = m - best_backward_y;
+            }
+            return true;
+        }
+        for (int k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+            int k1_offset = offset + k1;
+            int x1;
+            if (k1 == -d || (k1 != d && v1[k1_offset - 1] < v1[k1_offset + 1]))
+                x1 = v1[k1_offset + 1];
+            else
+                x1 = v1[k1_offset - 1] + 1;
+            int y1 = x1 - k1;
+            while (x1 < n && y1 < m && a[x1] == b[y1]) {
+                x1++;
+                y1++;
+            }
+            v1[k1_offset] = x1;
+            if (x1 + y1 > best_forward && x1 <= n && y1 <= m) {
+                best_forward = x1 + y1;
+                best_forward_x = x1;
+                best_forward_y = y1;
+            }
+            if (x1 > n)
+                k1_end += 2;
+            else if (y1 > m)
+                k1_start += 2;
+            else if (front) {
+                int k2_offset = offset + delta - k1;
+                if (k2_offset >= 0 && k2_offset < v_len && v2[k2_offset] != -1 && x1 >= n - v2[k2_offset]) {
+                    *split_old = x1;
+                    *split_new = y1;
+                    return true;
+                }
+            }
+        }
+        for (int k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+            int k2_offset = offset + k2;
+            int x2;
+            if (k2 == -d || (k2 != d && v2[k2_offset - 1] < v2[k2_offset + 1]))
+                x2 = v2[k2_offset + 1];
+            else
+                x2 = v2[k2_offset - 1] + 1;
+            int y2 = x2 - k2;
+            while (x2 < n && y2 < m && a[n - x2 - 1] == b[m - y2 - 1]) {
+                x2++;
+                y2++;
+            }
+            v2[k2_offset] = x2;
+            if (x2 + y2 > best_backward && x2 <= n && y2 <= m) {
+                best_backward = x2 + y2;
+                best_backward_x = x2;
+                best_backward_y = y2;
+            }
+            if (x2 > n)
+                k2_end += 2;
+            else if (y2 > m)
+                k2_start += 2;
+            else if (!front) {
+                int k1_offset = offset + delta - k2;
+                if (k1_offset >= 0 && k1_offset < v_len && v1[k1_offset] != -1) {
+                    int x1 = v1[k1_offset];
+                    if (x1 >= n - x2) {
+                        *split_old = x1;
+                        *split_new = x1 - (k1_offset - offset);
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+static void mark_changed(DiffContext* ctx, int old_lo, int old_hi, int new_lo, int new_hi) {
+    for (int i = old_lo; i < old_hi; i++)
+        ctx->deleted[ctx->old_index[i]] = true;
+    for (int i = new_lo; i < new_hi; i++)
+        ctx->inserted[ctx->new_index[i]] = true;
+}
+
+// Mark the lines changed between old_ids[old_lo, old_hi) and new_ids[new_lo, new_hi).
+static void diff_range(DiffContext* ctx, int old_lo, int old_hi, int new_lo, int new_hi) {
+    while (old_lo < old_hi && new_lo < new_hi && ctx->old_ids[old_lo] == ctx->new_ids[new_lo]) {
+        old_lo++;
+        new_lo++;
+    }
+    while (old_lo < old_hi && new_lo < new_hi && ctx->old_ids[old_hi - 1] == ctx->new_ids[new_hi - 1]) {
+        old_hi--;
+        new_hi--;
+    }
+    if (old_lo == old_hi || new_lo == new_hi) {
+        mark_changed(ctx, old_lo, old_hi, new_lo, new_hi);
+        return;
+    }
+
+    int split_old, split_new;
+    if (!find_split(ctx, old_lo, old_hi, new_lo, new_hi, &split_old, &split_new)
+        || (split_old == 0 && split_new == 0)
+        || (split_old == old_hi - old_lo && split_new == new_hi - new_lo)) {
+        mark_changed(ctx, old_lo, old_hi, new_lo, new_hi);
+        return;
+    }
+    diff_range(ctx, old_lo, old_lo + split_old, new_lo, new_lo + split_new);
+    diff_range(ctx, old_lo + split_old, old_hi, new_lo + split_new, new_hi);
+}
+
+static void push_edit(diff_edit_arr* edits, DiffOp op, int old_start, int new_start, int len) {
+    if (len > 0)
+        vec_DiffEdit_push(edits, (DiffEdit){.op = op, .old_start = old_start, .new_start = new_start, .len = len});
+}
+
+diff_edit_arr diff_lines(str_arr old_lines, str_arr new_lines) {
+    diff_edit_arr edits = vec_DiffEdit_create();
+    int old_len = old_lines.len;
+    int new_len = new_lines.len;
+    int total = old_len + new_len;
+    DiffContext ctx = {
+        .old_ids = malloc((old_len + 1) * sizeof(int)),
+        .new_ids = malloc((new_len + 1) * sizeof(int)),
+        .old_index = malloc((old_len + 1) * sizeof(int)),
+        .new_index = malloc((new_len + 1) * sizeof(int)),
+        .forward = malloc((total + 4) * sizeof(int)),
+        .backward = malloc((total + 4) * sizeof(int)),
+        .deleted = calloc(old_len + 1, sizeof(bool)),
+        .inserted = calloc(new_len + 1, sizeof(bool)),
+        .cost_limit = MIN_COST_LIMIT
+    };
+    // Roughly the square root of the number of diagonals, as in `diff`
+    int cost = 1;
+    for (int diagonals = total + 3; diagonals != 0; diagonals >>= 2)
+        cost <<= 1;
+    if (cost > ctx.cost_limit)
+        ctx.cost_limit = cost;
+    int* old_counts = NULL;
+    int* new_counts = NULL;
+    int num_ids = -1;
+    if (ctx.old_ids != NULL && ctx.new_ids != NULL && ctx.old_index != NULL && ctx.new_index != NULL
+        && ctx.forward != NULL && ctx.backward != NULL && ctx.deleted != NULL && ctx.inserted != NULL)
+        num_ids = assign_ids(old_lines, new_lines, ctx.old_ids, ctx.new_ids);
+    if (num_ids >= 0) {
+        old_counts = calloc(num_ids + 1, sizeof(int));
+        new_counts = calloc(num_ids + 1, sizeof(int));
+    }
+    if (old_counts == NULL || new_counts == NULL) {
+        // Without the memory to search, everything is changed
+        push_edit(&edits, DiffDelete, 0, 0, old_len);
+        push_edit(&edits, DiffInsert, old_len, 0, new_len);
+        goto cleanup;
+    }
+
+    /* Lines that only appear on one side can't be part of any common
+    subsequence, so they're changed no matter what. Leaving them out of
+    the search keeps the edit script minimal, and makes the search much
+    faster when most changed lines are unique (as in most real diffs). */
+    for (int i = 0; i < old_len; i++)
+        old_counts[ctx.old_ids[i]]++;
+    for (int i = 0; i < new_len; i++)
+        new_counts[ctx.new_ids[i]]++;
+    int num_old = 0;
+    for (int i = 0; i < old_len; i++) {
+        if (new_counts[ctx.old_ids[i]] == 0)
+            ctx.deleted[i] = true;
+        else {
+            ctx.old_ids[num_old] = ctx.old_ids[i];
+            ctx.old_index[num_old++] = i;
+        }
+    }
+    int num_new = 0;
+    for (int i = 0; i < new_len; i++) {
+        if (old_counts[ctx.new_ids[i]] == 0)
+            ctx.inserted[i] = true;
+        else {
+            ctx.new_ids[num_new] = ctx.new_ids[i];
+            ctx.new_index[num_new++] = i;
+        }
+    }
+    diff_range(&ctx, 0, num_old, 0, num_new);
+
+    // Turn the changed lines into runs of edits
+    int i = 0;
+    int j = 0;
+    while (i < old_len || j < new_len) {
+        int run = 0;
+        while (i + run < old_len && ctx.deleted[i + run])
+            run++;
+        push_edit(&edits, DiffDelete, i, j, run);
+        i += run;
+        run = 0;
+        while (j + run < new_len && ctx.inserted[j + run])
+            run++;
+        push_edit(&edits, DiffInsert, i, j, run);
+        j += run;
+        run = 0;
+        while (i + run < old_len && j + run < new_len && !ctx.deleted[i + run] && !ctx.inserted[j + run])
+            run++;
+        push_edit(&edits, DiffEqual, i, j, run);
+        i += run;
+        j += run;
+    }
+
+cleanup:
+    free(old_counts);
+    free(new_counts);
+    free(ctx.old_ids);
+    free(ctx.new_ids);
+    free(ctx.old_index);
+    free(ctx.new_index);
+    free(ctx.forward);
+    free(ctx.backward);
+    free(ctx.deleted);
+    free(ctx.inserted);
+    return edits;
+}
+
+bool diff_has_changes(diff_edit_arr edits) {
+    for (int i = 0; i < edits.len; i++) {
+        if (edits.data[i].op != DiffEqual)
+            return true;
+    }
+    return false;
+}
+
+static void writer_flush(DiffWriter* writer) {
+    if (writer->buf.len > 0 && file_write_str(writer->file, dynstr_to_str(writer->buf)) != (size_t)writer->buf.len)
+        writer->ok = false;
+    dynstr_clear(&writer->buf);
+}
+
+static void write_lines(DiffWriter* writer, char prefix, str_arr lines, int start, int len,
+                        bool missing_newline) {
+    for (int i = start; i < start + len; i++) {
+        dynstr_append_char(&writer->buf, prefix);
+        dynstr_append_str(&writer->buf, lines.data[i]);
+        dynstr_append_char(&writer->buf, '\n');
+        if (missing_newline && i == lines.len - 1)
+            dynstr_append(&writer->buf, "\\ No newline at end of file\n");
+        if (writer->buf.len >= WRITE_BUF_SIZE)
+            writer_flush(writer);
+    }
+}
+
+// Append a hunk range, where empty ranges start at the line before them.
+static void write_range(DiffWriter* writer, int start, int len) {
+    char range[32];
+    if (len == 1)
+        snprintf(range, sizeof(range), "%d", start + 1);
+    else
+        snprintf(range, sizeof(range), "%d,%d", len == 0 ? start : start + 1, len);
+    dynstr_append(&writer->buf, range);
+}
+
+bool diff_write_unified(File* output, str_arr old_lines, str_arr new_lines, diff_edit_arr edits,
+                        DiffOptions options) {
+    if (!diff_has_changes(edits))
+        return true;
+    int context = options.context == 0 ? DEFAULT_CONTEXT : options.context < 0 ? 0 : options.context;
+    DiffWriter writer = {.file = output, .buf = dynstr_create(), .ok = true};
+    dynstr_append(&writer.buf, "--- ");
+    dynstr_append_str(&writer.buf, options.old_label.len > 0 ? options.old_label : STR("a"));
+    dynstr_append(&writer.buf, "\n+++ ");
+    dynstr_append_str(&writer.buf, options.new_label.len > 0 ? options.new_label : STR("b"));
+    dynstr_append_char(&writer.buf, '\n');
+
+    int i = 0;
+    while (i < edits.len) {
+        if (edits.data[i].op == DiffEqual) {
+            i++;
+            continue;
+        }
+        // Extend the hunk over every change separated by at most twice the context
+        int first = i;
+        int last = i;
+        while (last + 1 < edits.len) {
+            DiffEdit next = edits.data[last + 1];
+            if (next.op != DiffEqual)
+                last++;
+            else if (last + 2 < edits.len && next.len <= 2 * context)
+                last += 2;
+            else
+                break;
+        }
+        int leading = 0;
+        if (first > 0)
+            leading = edits.data[first - 1].len < context ? edits.data[first - 1].len : context;
+        int trailing = 0;
+        if (last + 1 < edits.len)
+            trailing = edits.data[last + 1].len < context ? edits.data[last + 1].len : context;
+
+        int old_start = edits.data[first].old_start - leading;
+        int new_start = edits.data[first].new_start - leading;
+        int old_len = leading + trailing;
+        int new_len = leading + trailing;
+        for (int k = first; k <= last; k++) {
+            if (edits.data[k].op != DiffInsert)
+                old_len += edits.data[k].len;
+            if (edits.data[k].op != DiffDelete)
+                new_len += edits.data[k].len;
+        }
+        dynstr_append(&writer.buf, "@@ -");
+        write_range(&writer, old_start, old_len);
+        dynstr_append(&writer.buf, " +");
+        write_range(&writer, new_start, new_len);
+        dynstr_append(&writer.buf, " @@\n");
+
+        // Unchanged lines are written from the old side
+        bool old_missing = options.old_missing_newline;
+        write_lines(&writer, ' ', old_lines, old_start, leading, old_missing);
+        for (int k = first; k <= last; k++) {
+            DiffEdit edit = edits.data[k];
+            if (edit.op == DiffEqual)
+                write_lines(&writer, ' ', old_lines, edit.old_start, edit.len, old_missing);
+            else if (edit.op == DiffDelete)
+                write_lines(&writer, '-', old_lines, edit.old_start, edit.len, old_missing);
+            else
+                write_lines(&writer, '+', new_lines, edit.new_start, edit.len, options.new_missing_newline);
+        }
+        if (trailing > 0)
+            write_lines(&writer, ' ', old_lines, edits.data[last + 1].old_start, trailing, old_missing);
+        i = last + 1;
+    }
+    writer_flush(&writer);
+    dynstr_free(writer.buf);
+    return writer.ok;
+}
+
+/* Split a file's contents into lines, which point into the contents.
+Each line includes its newline (if it has one), so that a last line
+without one doesn't compare equal to the same line with one. */
+static str_arr split_lines(str contents) {
+    str_arr lines = str_arr_create();
+    char* pos = contents.data;
+    char* end = contents.data + contents.len;
+    while (pos < end) {
+        char* newline = memchr(pos, '\n', end - pos);
+        char* line_end = newline != NULL ? newline + 1 : end;
+        vec_str_push(&lines, (str){.data = pos, .len = line_end - pos});
+        pos = line_end;
+    }
+    return lines;
+}
+
+// Drop the newlines from lines split by `split_lines`, returning true if the last line had none.
+static bool strip_newlines(str_arr lines) {
+    bool missing_newline = false;
+    for (int i = 0; i < lines.len; i++) {
+        if (lines.data[i].data[lines.data[i].len - 1] == '\n')
+            lines.data[i].len--;
+        else
+            missing_newline = true;
+    }
+    return missing_newline;
+}
+
+int diff_files(File* old_file, File* new_file, File* output, DiffOptions options) {
+    str old_contents = file_read_all(old_file);
+    str new_contents = file_read_all(new_file);
+    int result = -1;
+    if (old_contents.data != NULL && new_contents.data != NULL && !ferror(old_file->ptr) && !ferror(new_file->ptr)) {
+        str_arr old_lines = split_lines(old_contents);
+        str_arr new_lines = split_lines(new_contents);
+        diff_edit_arr edits = diff_lines(old_lines, new_lines);
+        options.old_missing_newline = strip_newlines(old_lines);
+        options.new_missing_newline = strip_newlines(new_lines);
+        if (diff_write_unified(output, old_lines, new_lines, edits, options))
+            result = diff_has_changes(edits);
+        vec_DiffEdit_free(edits);
+        str_arr_free(old_lines);
+        str_arr_free(new_lines);
+    }
+    free(old_contents.data);
+    free(new_contents.data);
+    return result;
+}
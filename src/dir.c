@@ -0,0 +1,647 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "dir.h"
+#include "str.h"
+#include "vec.h"
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define DENTS_BUF_SIZE   (64 * 1024)
+
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t used;
+    size_t cap;
+    char data[];
+} ArenaBlock;
+
+static void arena_free(ArenaBlock* arena) {
+    while (arena != NULL) {
+        ArenaBlock* next = arena->next;
+        free(arena);
+        arena = next;
+    }
+}
+
+static char* arena_alloc(ArenaBlock** arena, size_t size) {
+    ArenaBlock* block = *arena;
+    if (block == NULL || block->cap - block->used < size) {
+        size_t cap = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        ArenaBlock* new_block = malloc(sizeof(ArenaBlock) + cap);
+        if (new_block == NULL)
+            return NULL;
+        new_block->next = block;
+        new_block->used = 0;
+        new_block->cap = cap;
+        *arena = block = new_block;
+    }
+    char* ptr = &block->data[block->used];
+    block->used += size;
+    return ptr;
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(((str*)a)->data, ((str*)b)->data);
+}
+
+#ifdef _WIN32
+// Match a glob of `*` and `?` wildcards against a name.
+static bool glob_match(char* pattern, char* name) {
+    char* star = NULL;
+    char* star_name = NULL;
+    while (*name != '\0') {
+        if (*pattern == '*') {
+            // Try matching nothing first, and more of the name on mismatches
+            star = pattern++;
+            star_name = name;
+        }
+        else if (*pattern == '?' || *pattern == *name) {
+            pattern++;
+            name++;
+        }
+        else if (star != NULL) {
+            pattern = star + 1;
+            name = ++star_name;
+        }
+        else
+            return false;
+    }
+    while (*pattern == '*')
+        pattern++;
+    return *pattern == '\0';
+}
+#endif
+
+static bool dir_name_matches(char* pattern, char* name) {
+#ifdef __linux__
+    return fnmatch(pattern, name, 0) == 0;
+#elifdef _WIN32
+    return glob_match(pattern, name);
+#endif
+}
+
+static bool dir_entry_passes(DirWalkOptions* options, char* name, int name_len, DirEntry* entry) {
+    if (options->extension.len > 0) {
+        if (name_len < options->extension.len)
+            return false;
+        if (memcmp(name + name_len - options->extension.len,
+                   options->extension.data, options->extension.len) != 0)
+            return false;
+    }
+    if (options->name_pattern.len > 0 && !dir_name_matches(options->name_pattern.data, name))
+        return false;
+    if (entry->size < options->min_size)
+        return false;
+    if (options->max_size > 0 && entry->size > options->max_size)
+        return false;
+    if (options->modified_after > 0 && entry->modified_time < options->modified_after)
+        return false;
+    if (options->modified_before > 0 && entry->modified_time >= options->modified_before)
+        return false;
+    return true;
+}
+
+//\ An open directory that its subdirectories are opened
+//\ relative to, so that they can't be swapped out for
+//\ symlinks between being listed and being read. It's
+//\ closed once it's no longer referenced.
+typedef struct {
+    int fd;
+    atomic_int refs;
+} DirHandle;
+
+typedef struct {
+    char* path;
+    int len;
+    int depth;
+    //\ The directory this one is in (NULL for the root, and
+    //\ on Windows), and where its name starts in `path`.
+    DirHandle* parent;
+    int name_offset;
+} PendingDir;
+
+DEFINE_VEC(PendingDir)
+
+#ifdef __linux__
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+static void dir_handle_release(DirHandle* handle) {
+    if (handle != NULL && atomic_fetch_sub(&handle->refs, 1) == 1) {
+        close(handle->fd);
+        free(handle);
+    }
+}
+
+typedef struct {
+    DirWalkOptions options;
+    DirWalkCallback callback;
+    void* context;
+    // Directories waiting to be read, guarded by `lock`
+    Vec(PendingDir) pending;
+    int active_workers;
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+    // Serializes callbacks
+    pthread_mutex_t callback_lock;
+    atomic_bool stopped;
+    // Set (along with `stopped`) if memory ran out
+    atomic_bool failed;
+} DirWalk;
+
+typedef struct {
+    DirWalk* walk;
+    ArenaBlock* arena;
+    str_arr paths;
+} DirWorker;
+
+// Stop a walk that ran out of memory, so that it fails rather than returning part of the tree.
+static void dir_walk_fail(DirWalk* walk) {
+    atomic_store(&walk->failed, true);
+    atomic_store(&walk->stopped, true);
+}
+
+static void dir_emit(DirWorker* worker, DirEntry entry) {
+    DirWalk* walk = worker->walk;
+    if (walk->callback != NULL) {
+        pthread_mutex_lock(&walk->callback_lock);
+        if (!atomic_load(&walk->stopped) && !walk->callback(entry, walk->context))
+            atomic_store(&walk->stopped, true);
+        pthread_mutex_unlock(&walk->callback_lock);
+        return;
+    }
+    char* path = arena_alloc(&worker->arena, entry.path.len + 1);
+    if (path == NULL || !vec_str_push(&worker->paths, (str){.data = path, .len = entry.path.len})) {
+        dir_walk_fail(walk);
+        return;
+    }
+    memcpy(path, entry.path.data, entry.path.len + 1);
+}
+
+/* Take a reference to the handle for an open directory, creating it if
+it doesn't exist yet. Returns false if memory couldn't be allocated. */
+static bool dir_handle_acquire(DirHandle** handle, int fd) {
+    if (*handle == NULL) {
+        *handle = malloc(sizeof(DirHandle));
+        if (*handle == NULL)
+            return false;
+        (*handle)->fd = fd;
+        // The reader's own reference
+        atomic_init(&(*handle)->refs, 1);
+    }
+    atomic_fetch_add(&(*handle)->refs, 1);
+    return true;
+}
+
+// Read one directory, emitting its entries and queueing its subdirectories.
+static void dir_read(DirWorker* worker, PendingDir dir, char* dents, dynstr* child_path, Vec(PendingDir)* subdirs) {
+    DirWalk* walk = worker->walk;
+    DirWalkOptions* options = &walk->options;
+    bool needs_stat = options->stat_entries || options->min_size > 0 || options->max_size > 0
+                   || options->modified_after > 0 || options->modified_before > 0;
+    bool descend = options->max_depth <= 0 || dir.depth + 1 < options->max_depth;
+
+    int fd;
+    if (dir.parent != NULL)
+        fd = openat(dir.parent->fd, dir.path + dir.name_offset, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    else
+        fd = openat(AT_FDCWD, dir.path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    dir_handle_release(dir.parent);
+    if (fd < 0)
+        return;
+    // Created when the first subdirectory is found
+    DirHandle* handle = NULL;
+
+    while (!atomic_load(&walk->stopped)) {
+        long num_bytes = syscall(SYS_getdents64, fd, dents, DENTS_BUF_SIZE);
+        if (num_bytes <= 0)
+            break;
+        for (long offset = 0; offset < num_bytes;) {
+            struct linux_dirent64* dent = (struct linux_dirent64*)(dents + offset);
+            offset += dent->d_reclen;
+
+            char* name = dent->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+            if (name[0] == '.' && !options->include_hidden)
+                continue;
+
+            bool is_directory = dent->d_type == DT_DIR;
+            DirEntry entry = {0};
+            // Some filesystems don't report entry types
+            if (needs_stat || dent->d_type == DT_UNKNOWN) {
+                struct stat st;
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                    continue;
+                is_directory = S_ISDIR(st.st_mode);
+                entry.size = st.st_size;
+                entry.modified_time = st.st_mtim.tv_sec;
+            }
+            entry.is_directory = is_directory;
+
+            int name_len = strlen(name);
+            dynstr_clear(child_path);
+            bool built = dynstr_append_str(child_path, (str){.data = dir.path, .len = dir.len});
+            if (built && dir.len > 0 && dir.path[dir.len - 1] != '/')
+                built = dynstr_append_char(child_path, '/');
+            if (!built || !dynstr_append_str(child_path, (str){.data = name, .len = name_len})) {
+                dir_walk_fail(walk);
+                break;
+            }
+            entry.path = (str){.data = child_path->data, .len = child_path->len};
+
+            if (is_directory && descend) {
+                bool queued = false;
+                if (dir_handle_acquire(&handle, fd)) {
+                    PendingDir subdir = {
+                        .path = malloc(child_path->len + 1),
+                        .len = child_path->len,
+                        .depth = dir.depth + 1,
+                        .parent = handle,
+                        .name_offset = child_path->len - name_len
+                    };
+                    queued = subdir.path != NULL && vec_PendingDir_push(subdirs, subdir);
+                    if (queued)
+                        memcpy(subdir.path, child_path->data, child_path->len + 1);
+                    else {
+                        free(subdir.path);
+                        dir_handle_release(handle);
+                    }
+                }
+                if (!queued) {
+                    dir_walk_fail(walk);
+                    break;
+                }
+            }
+            if ((!is_directory || options->include_directories)
+                && dir_entry_passes(options, name, name_len, &entry))
+                dir_emit(worker, entry);
+        }
+    }
+    if (handle != NULL)
+        dir_handle_release(handle);
+    else
+        close(fd);
+}
+
+static void* dir_worker_run(void* arg) {
+    DirWorker* worker = arg;
+    DirWalk* walk = worker->walk;
+    char* dents = malloc(DENTS_BUF_SIZE);
+    dynstr child_path = dynstr_create();
+    Vec(PendingDir) subdirs = vec_PendingDir_create();
+    if (dents == NULL)
+        dir_walk_fail(walk);
+
+    while (true) {
+        pthread_mutex_lock(&walk->lock);
+        while (walk->pending.len == 0 && walk->active_workers > 0 && !atomic_load(&walk->stopped))
+            pthread_cond_wait(&walk->work_available, &walk->lock);
+        // Nothing is queued and nobody can queue anything else
+        if (walk->pending.len == 0 || atomic_load(&walk->stopped)) {
+            pthread_cond_broadcast(&walk->work_available);
+            pthread_mutex_unlock(&walk->lock);
+            break;
+        }
+        // Taking the most recent directory keeps the queue short
+        PendingDir dir = walk->pending.data[--walk->pending.len];
+        walk->active_workers++;
+        pthread_mutex_unlock(&walk->lock);
+
+        dir_read(worker, dir, dents, &child_path, &subdirs);
+        free(dir.path);
+
+        pthread_mutex_lock(&walk->lock);
+        if (!vec_PendingDir_extend(&walk->pending, subdirs)) {
+            dir_walk_fail(walk);
+            for (int i = 0; i < subdirs.len; i++) {
+                free(subdirs.data[i].path);
+                dir_handle_release(subdirs.data[i].parent);
+            }
+        }
+        walk->active_workers--;
+        // Waiting workers are woken to stop as well
+        if (subdirs.len > 0 || walk->active_workers == 0 || atomic_load(&walk->stopped))
+            pthread_cond_broadcast(&walk->work_available);
+        pthread_mutex_unlock(&walk->lock);
+        vec_PendingDir_clear(&subdirs);
+    }
+
+    vec_PendingDir_free(subdirs);
+    dynstr_free(child_path);
+    free(dents);
+    return NULL;
+}
+
+static void dir_workers_free(DirWorker* workers, int num_workers) {
+    for (int i = 0; i < num_workers; i++) {
+        vec_str_free(workers[i].paths);
+        arena_free(workers[i].arena);
+    }
+    free(workers);
+}
+
+/* Walk a tree with `walk`'s options, leaving each worker's results in `workers`.
+Returns false (with nothing left in `workers`) if `root` couldn't be opened
+or memory ran out. */
+static bool dir_walk_run(str root, DirWalk* walk, DirWorker** workers, int* num_workers) {
+    int fd = openat(AT_FDCWD, root.data, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    close(fd);
+
+    int num_threads = walk->options.num_threads;
+    if (num_threads <= 0)
+        num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads <= 0)
+        num_threads = 1;
+
+    walk->pending = vec_PendingDir_create();
+    PendingDir root_dir = {.path = malloc(root.len + 1), .len = root.len, .depth = 0};
+    *workers = calloc(num_threads, sizeof(DirWorker));
+    if (root_dir.path == NULL || *workers == NULL || !vec_PendingDir_push(&walk->pending, root_dir)) {
+        free(root_dir.path);
+        free(*workers);
+        *workers = NULL;
+        vec_PendingDir_free(walk->pending);
+        return false;
+    }
+    memcpy(root_dir.path, root.data, root.len);
+    root_dir.path[root.len] = '\0';
+
+    walk->active_workers = 0;
+    atomic_init(&walk->stopped, false);
+    atomic_init(&walk->failed, false);
+    pthread_mutex_init(&walk->lock, NULL);
+    pthread_mutex_init(&walk->callback_lock, NULL);
+    pthread_cond_init(&walk->work_available, NULL);
+
+    // Without memory for the threads, the walk runs on this thread below
+    pthread_t* threads = malloc(sizeof(pthread_t) * num_threads);
+    int num_started = 0;
+    for (int i = 0; i < num_threads; i++) {
+        (*workers)[i].walk = walk;
+        (*workers)[i].paths = vec_str_create();
+        if (threads != NULL && pthread_create(&threads[num_started], NULL, dir_worker_run, &(*workers)[i]) == 0)
+            num_started++;
+    }
+    // Walk on this thread if no threads could be started
+    if (num_started == 0)
+        dir_worker_run(&(*workers)[0]);
+    for (int i = 0; i < num_started; i++)
+        pthread_join(threads[i], NULL);
+    *num_workers = num_threads;
+
+    // Directories left over from a stopped walk
+    for (int i = 0; i < walk->pending.len; i++) {
+        free(walk->pending.data[i].path);
+        dir_handle_release(walk->pending.data[i].parent);
+    }
+    vec_PendingDir_free(walk->pending);
+    pthread_cond_destroy(&walk->work_available);
+    pthread_mutex_destroy(&walk->callback_lock);
+    pthread_mutex_destroy(&walk->lock);
+    free(threads);
+    if (atomic_load(&walk->failed)) {
+        dir_workers_free(*workers, num_threads);
+        *workers = NULL;
+        return false;
+    }
+    return true;
+}
+
+DirListing dir_walk(str root, DirWalkOptions options) {
+    DirListing listing = {.paths = str_arr_create(), .arena = NULL};
+    DirWalk walk = {.options = options};
+    DirWorker* workers = NULL;
+    int num_workers = 0;
+    if (!dir_walk_run(root, &walk, &workers, &num_workers))
+        return listing;
+
+    // Merge each worker's paths and arena into the listing
+    int num_paths = 0;
+    for (int i = 0; i < num_workers; i++) {
+        if (workers[i].paths.len > INT_MAX - num_paths) {
+            dir_workers_free(workers, num_workers);
+            return listing;
+        }
+        num_paths += workers[i].paths.len;
+    }
+    if (!vec_str_reserve(&listing.paths, num_paths)) {
+        dir_workers_free(workers, num_workers);
+        return listing;
+    }
+    ArenaBlock* arena = NULL;
+    for (int i = 0; i < num_workers; i++) {
+        // Enough room was reserved above, so this can't fail
+        vec_str_extend(&listing.paths, workers[i].paths);
+        vec_str_free(workers[i].paths);
+        ArenaBlock* block = workers[i].arena;
+        while (block != NULL) {
+            ArenaBlock* next = block->next;
+            block->next = arena;
+            arena = block;
+            block = next;
+        }
+    }
+    listing.arena = arena;
+    free(workers);
+
+    if (options.sorted)
+        qsort(listing.paths.data, listing.paths.len, sizeof(str), compare_paths);
+    return listing;
+}
+
+bool dir_walk_each(str root, DirWalkOptions options, DirWalkCallback callback, void* context) {
+    DirWalk walk = {.options = options, .callback = callback, .context = context};
+    DirWorker* workers = NULL;
+    int num_workers = 0;
+    if (!dir_walk_run(root, &walk, &workers, &num_workers))
+        return false;
+
+    dir_workers_free(workers, num_workers);
+    return !atomic_load(&walk.stopped);
+}
+
+#elifdef _WIN32
+
+// Seconds between the FILETIME epoch (1601) and the Unix epoch
+#define FILETIME_UNIX_OFFSET 11644473600LL
+
+typedef struct {
+    DirWalkOptions options;
+    DirWalkCallback callback;
+    void* context;
+    DirListing* listing;
+    bool stopped;
+    // Set (along with `stopped`) if memory ran out
+    bool failed;
+} DirWalk;
+
+// Stop a walk that ran out of memory, so that it fails rather than returning part of the tree.
+static void dir_walk_fail(DirWalk* walk) {
+    walk->failed = true;
+    walk->stopped = true;
+}
+
+/* Read one directory, emitting its entries and queueing its subdirectories.
+Directories are read on the calling thread, since FindFirstFileEx has no
+equivalent of opening entries relative to a directory handle. */
+static void dir_read(DirWalk* walk, PendingDir dir, dynstr* child_path, Vec(PendingDir)* pending) {
+    DirWalkOptions* options = &walk->options;
+    bool descend = options->max_depth <= 0 || dir.depth + 1 < options->max_depth;
+
+    dynstr_clear(child_path);
+    if (!dynstr_append_str(child_path, (str){.data = dir.path, .len = dir.len})
+        || !dynstr_append(child_path, "\\*")) {
+        dir_walk_fail(walk);
+        return;
+    }
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileExA(child_path->data, FindExInfoBasic, &data, FindExSearchNameMatch,
+                                   NULL, FIND_FIRST_EX_LARGE_FETCH);
+    if (find == INVALID_HANDLE_VALUE)
+        return;
+
+    do {
+        char* name = data.cFileName;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            continue;
+        if (name[0] == '.' && !options->include_hidden)
+            continue;
+
+        // Like the Linux walk, symlinks (and other reparse points) aren't followed
+        bool is_directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                         && !(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT);
+        uint64_t write_time = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32)
+                            | data.ftLastWriteTime.dwLowDateTime;
+        DirEntry entry = {
+            .size = ((int64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow,
+            .modified_time = write_time / 10000000 - FILETIME_UNIX_OFFSET,
+            .is_directory = is_directory
+        };
+
+        int name_len = strlen(name);
+        dynstr_clear(child_path);
+        bool built = dynstr_append_str(child_path, (str){.data = dir.path, .len = dir.len});
+        if (built && dir.len > 0 && dir.path[dir.len - 1] != '/' && dir.path[dir.len - 1] != '\\')
+            built = dynstr_append_char(child_path, '/');
+        if (!built || !dynstr_append_str(child_path, (str){.data = name, .len = name_len})) {
+            dir_walk_fail(walk);
+            break;
+        }
+        entry.path = (str){.data = child_path->data, .len = child_path->len};
+
+        if (is_directory && descend) {
+            PendingDir subdir = {
+                .path = malloc(child_path->len + 1),
+                .len = child_path->len,
+                .depth = dir.depth + 1
+            };
+            if (subdir.path != NULL && vec_PendingDir_push(pending, subdir))
+                memcpy(subdir.path, child_path->data, child_path->len + 1);
+            else {
+                free(subdir.path);
+                dir_walk_fail(walk);
+                break;
+            }
+        }
+        if ((!is_directory || options->include_directories)
+            && dir_entry_passes(options, name, name_len, &entry)) {
+            if (walk->callback != NULL)
+                walk->stopped = !walk->callback(entry, walk->context);
+            else {
+                char* path = arena_alloc((ArenaBlock**)&walk->listing->arena, entry.path.len + 1);
+                if (path == NULL || !vec_str_push(&walk->listing->paths, (str){.data = path, .len = entry.path.len}))
+                    dir_walk_fail(walk);
+                else
+                    memcpy(path, entry.path.data, entry.path.len + 1);
+            }
+        }
+    } while (!walk->stopped && FindNextFileA(find, &data));
+    FindClose(find);
+}
+
+// Walk a tree with `walk`'s options on the calling thread.
+static bool dir_walk_run(str root, DirWalk* walk) {
+    DWORD attributes = GetFileAttributesA(root.data);
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+        return false;
+
+    Vec(PendingDir) pending = vec_PendingDir_create();
+    dynstr child_path = dynstr_create();
+    PendingDir root_dir = {.path = malloc(root.len + 1), .len = root.len, .depth = 0};
+    if (root_dir.path == NULL || !vec_PendingDir_push(&pending, root_dir)) {
+        free(root_dir.path);
+        vec_PendingDir_free(pending);
+        dynstr_free(child_path);
+        return false;
+    }
+    memcpy(root_dir.path, root.data, root.len);
+    root_dir.path[root.len] = '\0';
+
+    while (pending.len > 0 && !walk->stopped) {
+        PendingDir dir = pending.data[--pending.len];
+        dir_read(walk, dir, &child_path, &pending);
+        free(dir.path);
+    }
+    // Directories left over from a stopped walk
+    for (int i = 0; i < pending.len; i++)
+        free(pending.data[i].path);
+    vec_PendingDir_free(pending);
+    dynstr_free(child_path);
+    return !walk->failed;
+}
+
+DirListing dir_walk(str root, DirWalkOptions options) {
+    DirListing listing = {.paths = str_arr_create(), .arena = NULL};
+    DirWalk walk = {.options = options, .listing = &listing};
+    if (!dir_walk_run(root, &walk)) {
+        // Nothing is returned from a walk that ran out of memory
+        dir_listing_free(&listing);
+        return listing;
+    }
+    if (options.sorted)
+        qsort(listing.paths.data, listing.paths.len, sizeof(str), compare_paths);
+    return listing;
+}
+
+bool dir_walk_each(str root, DirWalkOptions options, DirWalkCallback callback, void* context) {
+    DirWalk walk = {.options = options, .callback = callback, .context = context};
+    return dir_walk_run(root, &walk) && !walk.stopped;
+}
+
+#endif
+
+void dir_listing_free(DirListing* listing) {
+    str_arr_free(listing->paths);
+    arena_free(listing->arena);
+    listing->paths = (str_arr){0};
+    listing->arena = NULL;
+}
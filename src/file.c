@@ -1,17 +1,51 @@
 #ifdef __linux__
+#define _GNU_SOURCE
 #define _POSIX_C_SOURCE 200809L
 #define _FILE_OFFSET_BITS 64
 #endif
 
+#include <errno.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <time.h>
+#include <unistd.h>
+#elifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILE_X86_SIMD
+#endif
 
 #include "file.h"
+#include "hash.h"
 #include "str.h"
 
 #define _FILE_NOT_OPEN_POS -1
+#define _FILE_NO_FD        -1
+// Alignment required of O_DIRECT buffers, offsets and sizes
+#define DIRECT_ALIGNMENT   4096
+#define DIRECT_CHUNK_SIZE  (8 * 1024 * 1024)
+#define FOLLOW_BUF_SIZE    65536
+#define LINES_BUF_SIZE     65536
+#define LINE_INDEX_BUF_SIZE (1024 * 1024)
+#define LINE_SCAN_BUF_SIZE 65536
+#define LINE_INDEX_INTERVAL 1024
+// Sidecar files start with this, followed by a LineIndexHeader
+#define LINE_INDEX_MAGIC   "FLI1"
+#define FOLLOW_FILE_EVENTS (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+#define FOLLOW_DIR_EVENTS  (IN_CREATE | IN_MOVED_TO)
+#define FOLLOW_DIR_CHANGES (FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE)
+// Longest wait between checks when changes can't be watched for
+#define FOLLOW_POLL_MS     100
 
 File file_open(str filename, FileAccessModes access_modes) {
     File file = {0};
@@ -47,6 +81,7 @@ File file_open(str filename, FileAccessModes access_modes) {
         dynstr_append_char(&access_modes_str, 'x');
 
     file.ptr = fopen(filename.data, access_modes_str.data);
+    dynstr_free(access_modes_str);
     // Magic value to indicate that opening failed
     if (file.ptr == NULL)
         file.position = _FILE_NOT_OPEN_POS;
@@ -54,6 +89,16 @@ File file_open(str filename, FileAccessModes access_modes) {
         file.position = file_get_position(file);
 
     file.access_modes = access_modes;
+    file.stat_cached = false;
+    file.direct_fd = _FILE_NO_FD;
+#ifdef __linux__
+    /* Unbuffered reads go through a separate descriptor, because
+    stdio's buffers don't meet O_DIRECT's alignment requirements.
+    Filesystems that don't support O_DIRECT fail this open, in
+    which case reads fall back to being buffered. */
+    if (file.ptr != NULL && (access_modes & FileDirect) && (access_modes & FileRead))
+        file.direct_fd = open(filename.data, O_RDONLY | O_DIRECT | O_CLOEXEC);
+#endif
 
     return file;
 }
@@ -64,6 +109,16 @@ bool file_is_open(File file) {
 
 void file_close(File* file) {
     fclose(file->ptr);
+#ifdef __linux__
+    if (file->direct_fd != _FILE_NO_FD)
+        close(file->direct_fd);
+#elifdef _WIN32
+    if (file->overlapped_handle != NULL)
+        CloseHandle(file->overlapped_handle);
+    file->overlapped_handle = NULL;
+#endif
+    file->direct_fd = _FILE_NO_FD;
+    file->stat_cached = false;
     file->position = _FILE_NOT_OPEN_POS;
 }
 
@@ -84,11 +139,7 @@ void file_rewind(File* file) {
 }
 
 int64_t file_get_length(File* file) {
-    int64_t current_position = file_get_position(*file);
-    file_seek(file, 0, FilePositionEnd);
-    int64_t length = file_get_position(*file);
-    file_seek(file, current_position, SEEK_SET);
-    return length;
+    return file_refresh_stat(file).size;
 }
 
 int64_t file_get_position(File file) {
@@ -99,25 +150,202 @@ int64_t file_get_position(File file) {
 #endif
 }
 
+FileStat file_stat(File* file) {
+    if (file->stat_cached)
+        return file->stat;
+    return file_refresh_stat(file);
+}
+
+FileStat file_refresh_stat(File* file) {
+    // Buffered writes wouldn't be reflected in the size otherwise
+    if (file->access_modes & (FileWrite | FileAppend))
+        fflush(file->ptr);
+
+    FileStat stat = {.size = -1};
+#ifdef __linux__
+    struct stat st;
+    if (fstat(fileno(file->ptr), &st) != 0)
+        return stat;
+    stat.modified_time = st.st_mtim.tv_sec;
+    stat.block_size = st.st_blksize;
+#elifdef _WIN32
+    struct _stat64 st;
+    if (_fstat64(_fileno(file->ptr), &st) != 0)
+        return stat;
+    stat.modified_time = st.st_mtime;
+    stat.block_size = 4096;
+#endif
+    stat.size = st.st_size;
+    stat.inode = st.st_ino;
+    stat.device = st.st_dev;
+    stat.is_regular = S_ISREG(st.st_mode);
+    stat.is_directory = S_ISDIR(st.st_mode);
+
+    file->stat = stat;
+    file->stat_cached = true;
+    return stat;
+}
+
+void file_attach_hasher(File* file, Hasher* hasher) {
+    file->hasher = hasher;
+}
+
+// Pass bytes that moved through the file's position to its hasher, if it has one.
+static void file_hash(File* file, void* data, size_t len) {
+    if (file->hasher != NULL && len > 0)
+        hasher_update(file->hasher, data, len);
+}
+
+bool file_advise(File* file, FileAccessHint hint, int64_t offset, int64_t length) {
+#ifdef __linux__
+    int fd = fileno(file->ptr);
+    int advice;
+    switch (hint) {
+        case FileHintNormal:     advice = POSIX_FADV_NORMAL;     break;
+        case FileHintSequential: advice = POSIX_FADV_SEQUENTIAL; break;
+        case FileHintRandom:     advice = POSIX_FADV_RANDOM;     break;
+        case FileHintWillNeed:
+            /* readahead() only schedules the range to be read into the
+            page cache, and returns without waiting for the reads */
+            if (length == 0)
+                length = file_stat(file).size - offset;
+            if (length < 0)
+                return false;
+            if (readahead(fd, offset, length) == 0)
+                return true;
+            advice = POSIX_FADV_WILLNEED;
+            break;
+        case FileHintDontNeed:   advice = POSIX_FADV_DONTNEED;   break;
+        case FileHintNoReuse:    advice = POSIX_FADV_NOREUSE;    break;
+        default: return false;
+    }
+    return posix_fadvise(fd, offset, length, advice) == 0;
+#elifdef _WIN32
+    /* Windows only takes access hints (FILE_FLAG_SEQUENTIAL_SCAN and
+    FILE_FLAG_RANDOM_ACCESS) when a file is opened, so hints can't be applied */
+    return false;
+#endif
+}
+
 str file_read_str(File* file, int64_t size) {
-    char buf[8192] = {};
-    fread(buf, sizeof(uint8_t), size, file->ptr);
+    char* buf = size >= 0 && size < INT_MAX ? malloc(size + 1) : NULL;
+    if (buf == NULL) {
+        errno = ENOMEM;
+        return (str){0};
+    }
+    size_t bytes_read = fread(buf, sizeof(uint8_t), size, file->ptr);
+    buf[bytes_read] = '\0';
+    file->position = file_get_position(*file);
+    file_hash(file, buf, bytes_read);
+    return (str){.data = buf, .len = bytes_read};
+}
+
+#ifdef __linux__
+// Read the rest of a file through its O_DIRECT descriptor.
+static str file_read_all_direct(File* file, int64_t remaining) {
+    // Sizes must be multiples of the alignment as well
+    int64_t cap = (remaining + DIRECT_ALIGNMENT) & ~(int64_t)(DIRECT_ALIGNMENT - 1);
+    char* buf = NULL;
+    if (posix_memalign((void**)&buf, DIRECT_ALIGNMENT, cap) != 0)
+        return (str){0};
+
+    int64_t total = 0;
+    while (total < cap) {
+        int64_t chunk = cap - total < DIRECT_CHUNK_SIZE ? cap - total : DIRECT_CHUNK_SIZE;
+        ssize_t bytes_read = pread(file->direct_fd, buf + total, chunk, file->position + total);
+        if (bytes_read < 0) {
+            free(buf);
+            return (str){0};
+        }
+        if (bytes_read == 0)
+            break;
+        total += bytes_read;
+        // A short read means the end of the file was reached
+        if (bytes_read < chunk)
+            break;
+    }
+    /* The file grew past the expected size, so leave the
+    read to the buffered path, which can grow its buffer */
+    if (total == cap) {
+        free(buf);
+        return (str){0};
+    }
+    buf[total] = '\0';
+
+    file_seek(file, file->position + total, FilePositionStart);
+    return (str){.data = buf, .len = total};
+}
+#endif
+
+str file_read_all(File* file) {
+    int64_t remaining = file_get_length(file) - file->position;
+    if (remaining < 0)
+        remaining = 0;
+
+#ifdef __linux__
+    if (file->direct_fd != _FILE_NO_FD && file->position % DIRECT_ALIGNMENT == 0) {
+        str string = file_read_all_direct(file, remaining);
+        if (string.data != NULL) {
+            file_hash(file, string.data, string.len);
+            return string;
+        }
+    }
+#endif
+
+    /* Ask for one byte more than expected, so that reaching
+    the end of the file is detected without another read */
+    size_t cap = remaining + 1;
+    char* buf = malloc(cap + 1);
+    if (buf == NULL) {
+        errno = ENOMEM;
+        return (str){0};
+    }
+    size_t total = fread(buf, sizeof(uint8_t), cap, file->ptr);
+    // The file grew (or reported no size, like files in /proc)
+    while (total == cap) {
+        cap *= 2;
+        char* new_buf = realloc(buf, cap + 1);
+        if (new_buf == NULL)
+            break;
+        buf = new_buf;
+        total += fread(buf + total, sizeof(uint8_t), cap - total, file->ptr);
+    }
+    buf[total] = '\0';
+
     file->position = file_get_position(*file);
-    dynstr tmp = DSTR(buf);
-    return dynstr_to_str(tmp);
+    file_hash(file, buf, total);
+    return (str){.data = buf, .len = total};
 }
 
 str file_read_until_delimiter(File* file, char delimiter) {
+#ifdef __linux__
+    char* line = NULL;
+    size_t cap = 0;
+    ssize_t len = getdelim(&line, &cap, delimiter, file->ptr);
+    file->position = file_get_position(*file);
+    if (len < 0) {
+        free(line);
+        return dynstr_to_str(dynstr_create());
+    }
+    file_hash(file, line, len);
+    if (len > 0 && line[len - 1] == delimiter)
+        line[--len] = '\0';
+    return (str){.data = line, .len = len};
+#elifdef _WIN32
     // TODO: Read more than 1 character at a time.
     dynstr string = dynstr_create();
-    char c;
-    while (c = fgetc(file->ptr)) {
+    int c;
+    while ((c = fgetc(file->ptr)) != EOF) {
         if (c == delimiter)
             break;
         dynstr_append_char(&string, c);
     }
     file->position = file_get_position(*file);
+    file_hash(file, string.data, string.len);
+    if (c == delimiter)
+        file_hash(file, &delimiter, 1);
     return dynstr_to_str(string);
+#endif
 }
 
 str file_read_line(File* file) {
@@ -129,10 +357,11 @@ str_arr file_read_lines(File* file, int64_t max_line_length) {
     char line[max_line_length];
     while (fgets(line, max_line_length, file->ptr)) {
         dynstr tmp = DSTR(line);
+        file_hash(file, tmp.data, tmp.len);
         str line_str = dynstr_to_str(tmp);
         // Remove the newlines
         if (line_str.data[line_str.len - 1] == '\n')
-            line_str.data[line_str.len - 1] = '\0';
+            line_str.data[--line_str.len] = '\0';
         str_arr_append(&lines, line_str);
         memset(line, 0, max_line_length);
     }
@@ -140,6 +369,46 @@ str_arr file_read_lines(File* file, int64_t max_line_length) {
     return lines;
 }
 
+Optional(str_pack) file_read_lines_packed(File* file) {
+    str_pack lines = str_pack_create();
+    char* buf = malloc(LINES_BUF_SIZE);
+    // Every push fails once the bytes would pass INT_MAX, which also keeps offsets in range
+    bool ok = buf != NULL;
+    bool in_line = false;
+    size_t bytes_read;
+    while (ok && (bytes_read = fread(buf, sizeof(char), LINES_BUF_SIZE, file->ptr)) > 0) {
+        file_hash(file, buf, bytes_read);
+        char* start = buf;
+        char* end = buf + bytes_read;
+        while (ok && start < end) {
+            // Lines can span multiple reads, so they're appended in pieces
+            if (!in_line) {
+                ok = vec_uint32_t_push(&lines.offsets, lines.bytes.len);
+                in_line = true;
+            }
+            char* newline = memchr(start, '\n', end - start);
+            char* piece_end = newline != NULL ? newline : end;
+            ok = ok && vec_char_push_n(&lines.bytes, start, piece_end - start);
+            if (newline != NULL) {
+                ok = ok && vec_char_push(&lines.bytes, '\0');
+                in_line = false;
+            }
+            start = piece_end + 1;
+        }
+    }
+    if (ok && in_line)
+        ok = vec_char_push(&lines.bytes, '\0');
+    if (ok && ferror(file->ptr))
+        ok = false;
+    free(buf);
+    file->position = file_get_position(*file);
+    if (!ok) {
+        str_pack_free(lines);
+        return None(str_pack);
+    }
+    return Some(str_pack, lines);
+}
+
 #define FILE_READ_GENERATOR(suffix, type)                                    \
     ssize_t file_read_##suffix(File* file, type* buffer, size_t count) {     \
         size_t bytes_read = 0;                                               \
@@ -155,6 +424,7 @@ str_arr file_read_lines(File* file, int64_t max_line_length) {
             }                                                                \
         }                                                                    \
         file->position = file_get_position(*file);                           \
+        file_hash(file, buffer, bytes_read * sizeof(type));                  \
         return bytes_read;                                                   \
     }                                                                        \
 
@@ -172,6 +442,8 @@ FILE_READ_GENERATOR(f64, double)
 size_t file_write_str(File* file, str string) {
     size_t bytes_written = fwrite(string.data, sizeof(uint8_t), string.len, file->ptr);
     file->position = file_get_position(*file);
+    file_hash(file, string.data, bytes_written);
+    file->stat_cached = false;
     return bytes_written;
 }
 
@@ -190,6 +462,8 @@ size_t file_write_str(File* file, str string) {
             }                                                                  \
         }                                                                      \
         file->position = file_get_position(*file);                             \
+        file->stat_cached = false;                                             \
+        file_hash(file, data, bytes_written * sizeof(type));                   \
         return bytes_written;                                                  \
     }                                                                          \
 
@@ -203,3 +477,783 @@ FILE_WRITE_GENERATOR(i64, int64_t)
 FILE_WRITE_GENERATOR(u64, uint64_t)
 FILE_WRITE_GENERATOR(f32, float)
 FILE_WRITE_GENERATOR(f64, double)
+
+#ifdef __linux__
+// Read until `size` bytes are read or the end of the file is reached.
+static ssize_t pread_full(File* file, void* buffer, size_t size, int64_t offset) {
+    int fd = fileno(file->ptr);
+    size_t total = 0;
+    while (total < size) {
+        ssize_t bytes_read = pread(fd, (char*)buffer + total, size - total, offset + total);
+        if (bytes_read < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (bytes_read == 0)
+            break;
+        total += bytes_read;
+    }
+    return total;
+}
+
+static ssize_t pwrite_full(File* file, void* data, size_t size, int64_t offset) {
+    int fd = fileno(file->ptr);
+    size_t total = 0;
+    while (total < size) {
+        ssize_t bytes_written = pwrite(fd, (char*)data + total, size - total, offset + total);
+        if (bytes_written < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (bytes_written == 0)
+            return -1;
+        total += bytes_written;
+    }
+    return total;
+}
+#elifdef _WIN32
+/* The CRT's handle is synchronous, so ReadFile and WriteFile would move its
+file pointer even with an offset given. Positional IO goes through a second
+handle opened for overlapped IO instead, which is opened on first use. */
+static HANDLE positional_handle(File* file) {
+    HANDLE handle = file->overlapped_handle;
+    if (handle != NULL)
+        return handle;
+    DWORD access = 0;
+    if (file->access_modes & FileRead)
+        access |= GENERIC_READ;
+    if (file->access_modes & (FileWrite | FileAppend))
+        access |= GENERIC_WRITE;
+    handle = ReOpenFile(
+        (HANDLE)_get_osfhandle(_fileno(file->ptr)), access,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, FILE_FLAG_OVERLAPPED
+    );
+    if (handle == INVALID_HANDLE_VALUE)
+        return NULL;
+    // Another thread may have opened one first
+    HANDLE existing = InterlockedCompareExchangePointer(&file->overlapped_handle, handle, NULL);
+    if (existing != NULL) {
+        CloseHandle(handle);
+        return existing;
+    }
+    return handle;
+}
+
+/* Read or write `size` bytes at `offset`, waiting on an event of the
+call's own so that concurrent calls on the handle don't wait on each
+other. Returns how many bytes were transferred, or -1 on errors. */
+static ssize_t positional_io(File* file, void* buffer, size_t size, int64_t offset, bool write) {
+    HANDLE handle = positional_handle(file);
+    if (handle == NULL)
+        return -1;
+    HANDLE event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (event == NULL)
+        return -1;
+    size_t total = 0;
+    while (total < size) {
+        DWORD chunk = size - total > 0x40000000 ? 0x40000000 : (DWORD)(size - total);
+        uint64_t position = offset + total;
+        OVERLAPPED overlapped = {0};
+        overlapped.Offset = (DWORD)position;
+        overlapped.OffsetHigh = (DWORD)(position >> 32);
+        overlapped.hEvent = event;
+        DWORD num_bytes = 0;
+        BOOL done = write ? WriteFile(handle, (char*)buffer + total, chunk, NULL, &overlapped)
+                          : ReadFile(handle, (char*)buffer + total, chunk, NULL, &overlapped);
+        if (done || GetLastError() == ERROR_IO_PENDING)
+            done = GetOverlappedResult(handle, &overlapped, &num_bytes, TRUE);
+        if (!done) {
+            if (!write && GetLastError() == ERROR_HANDLE_EOF)
+                break;
+            CloseHandle(event);
+            return -1;
+        }
+        if (num_bytes == 0) {
+            if (!write)
+                break;
+            CloseHandle(event);
+            return -1;
+        }
+        total += num_bytes;
+    }
+    CloseHandle(event);
+    return total;
+}
+
+static ssize_t pread_full(File* file, void* buffer, size_t size, int64_t offset) {
+    return positional_io(file, buffer, size, offset, false);
+}
+
+static ssize_t pwrite_full(File* file, void* data, size_t size, int64_t offset) {
+    return positional_io(file, data, size, offset, true);
+}
+#endif
+
+str file_pread_str(File* file, int64_t offset, int64_t size) {
+    char* buf = size >= 0 && size < INT_MAX ? malloc(size + 1) : NULL;
+    if (buf == NULL) {
+        errno = ENOMEM;
+        return (str){0};
+    }
+    ssize_t bytes_read = pread_full(file, buf, size, offset);
+    if (bytes_read < 0)
+        bytes_read = 0;
+    buf[bytes_read] = '\0';
+    return (str){.data = buf, .len = bytes_read};
+}
+
+/* A trailing partial element (at the end of the
+file) isn't counted as having been read */
+#define FILE_PREAD_GENERATOR(suffix, type)                                                         \
+    ssize_t file_pread_##suffix(File* file, int64_t offset, type* buffer, size_t count) {          \
+        ssize_t bytes_read = pread_full(file, buffer, count * sizeof(type), offset);                \
+        if (bytes_read < 0)                                                                        \
+            return -1;                                                                             \
+        return bytes_read / sizeof(type);                                                          \
+    }                                                                                              \
+
+FILE_PREAD_GENERATOR(i8, int8_t)
+FILE_PREAD_GENERATOR(u8, uint8_t)
+FILE_PREAD_GENERATOR(i16, int16_t)
+FILE_PREAD_GENERATOR(u16, uint16_t)
+FILE_PREAD_GENERATOR(i32, int32_t)
+FILE_PREAD_GENERATOR(u32, uint32_t)
+FILE_PREAD_GENERATOR(i64, int64_t)
+FILE_PREAD_GENERATOR(u64, uint64_t)
+FILE_PREAD_GENERATOR(f32, float)
+FILE_PREAD_GENERATOR(f64, double)
+
+ssize_t file_pwrite_str(File* file, int64_t offset, str string) {
+    return pwrite_full(file, string.data, string.len, offset);
+}
+
+#define FILE_PWRITE_GENERATOR(suffix, type)                                                        \
+    ssize_t file_pwrite_##suffix(File* file, int64_t offset, type* data, size_t count) {           \
+        ssize_t bytes_written = pwrite_full(file, data, count * sizeof(type), offset);             \
+        if (bytes_written < 0)                                                                     \
+            return -1;                                                                             \
+        return bytes_written / sizeof(type);                                                       \
+    }                                                                                              \
+
+FILE_PWRITE_GENERATOR(i8, int8_t)
+FILE_PWRITE_GENERATOR(u8, uint8_t)
+FILE_PWRITE_GENERATOR(i16, int16_t)
+FILE_PWRITE_GENERATOR(u16, uint16_t)
+FILE_PWRITE_GENERATOR(i32, int32_t)
+FILE_PWRITE_GENERATOR(u32, uint32_t)
+FILE_PWRITE_GENERATOR(i64, int64_t)
+FILE_PWRITE_GENERATOR(u64, uint64_t)
+FILE_PWRITE_GENERATOR(f32, float)
+FILE_PWRITE_GENERATOR(f64, double)
+
+typedef struct {
+    char magic[4];
+    uint32_t interval;
+    uint64_t inode;
+    uint64_t device;
+    int64_t indexed_size;
+    int64_t num_newlines;
+    int64_t last_line_start;
+    int64_t num_checkpoints;
+} LineIndexHeader;
+
+/* Count the newlines in a 64-byte block of the file at `offset`, given
+a mask with a bit set for each of them. `until_checkpoint` is the number
+of newlines left before the next line that needs a checkpoint. */
+static inline void index_newline_mask(FileLineIndex* index, int64_t* until_checkpoint,
+                                      uint64_t mask, int64_t offset) {
+    if (mask == 0)
+        return;
+    int count = __builtin_popcountll(mask);
+    index->num_newlines += count;
+    index->last_line_start = offset + 64 - __builtin_clzll(mask);
+    if (count < *until_checkpoint) {
+        *until_checkpoint -= count;
+        return;
+    }
+    while (mask != 0) {
+        int bit = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        if (--*until_checkpoint == 0) {
+            vec_int64_t_push(&index->checkpoints, offset + bit + 1);
+            *until_checkpoint = index->interval;
+        }
+    }
+}
+
+#ifdef FILE_X86_SIMD
+/* Each kernel handles as much of its input as it can in whole 64-byte
+blocks and returns how much input it consumed, leaving the rest to the
+scalar code. */
+
+__attribute__((target("avx2")))
+static size_t index_newlines_avx2(FileLineIndex* index, int64_t* until_checkpoint,
+                                  char* buf, size_t len, int64_t offset) {
+    __m256i newline = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i lo = _mm256_loadu_si256((__m256i*)(buf + i));
+        __m256i hi = _mm256_loadu_si256((__m256i*)(buf + i + 32));
+        uint64_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline))
+                      | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)) << 32;
+        index_newline_mask(index, until_checkpoint, mask, offset + i);
+    }
+    return i;
+}
+
+__attribute__((target("sse2")))
+static size_t index_newlines_sse2(FileLineIndex* index, int64_t* until_checkpoint,
+                                  char* buf, size_t len, int64_t offset) {
+    __m128i newline = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        uint64_t mask = 0;
+        for (int j = 0; j < 4; j++) {
+            __m128i chunk = _mm_loadu_si128((__m128i*)(buf + i + j * 16));
+            mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)) << (j * 16);
+        }
+        index_newline_mask(index, until_checkpoint, mask, offset + i);
+    }
+    return i;
+}
+#endif
+
+// Index the newlines in `len` bytes read from the file at `offset`.
+static void index_newlines(FileLineIndex* index, char* buf, size_t len, int64_t offset) {
+    int64_t until_checkpoint = index->interval - index->num_newlines % index->interval;
+    size_t consumed = 0;
+#ifdef FILE_X86_SIMD
+    if (__builtin_cpu_supports("avx2"))
+        consumed = index_newlines_avx2(index, &until_checkpoint, buf, len, offset);
+    else if (__builtin_cpu_supports("sse2"))
+        consumed = index_newlines_sse2(index, &until_checkpoint, buf, len, offset);
+#endif
+
+    char* pos = buf + consumed;
+    char* end = buf + len;
+    while ((pos = memchr(pos, '\n', end - pos)) != NULL) {
+        pos++;
+        index->num_newlines++;
+        index->last_line_start = offset + (pos - buf);
+        if (--until_checkpoint == 0) {
+            vec_int64_t_push(&index->checkpoints, offset + (pos - buf));
+            until_checkpoint = index->interval;
+        }
+    }
+}
+
+static void line_index_reset(FileLineIndex* index, FileStat stat) {
+    vec_int64_t_clear(&index->checkpoints);
+    vec_int64_t_push(&index->checkpoints, 0);
+    index->indexed_size = 0;
+    index->num_newlines = 0;
+    index->last_line_start = 0;
+    index->inode = stat.inode;
+    index->device = stat.device;
+}
+
+FileLineIndex file_line_index_build(File* file, int interval) {
+    FileLineIndex index = {0};
+    index.checkpoints = vec_int64_t_create();
+    index.interval = interval > 0 ? interval : LINE_INDEX_INTERVAL;
+    line_index_reset(&index, (FileStat){0});
+    file_line_index_update(file, &index);
+    return index;
+}
+
+bool file_line_index_update(File* file, FileLineIndex* index) {
+    FileStat stat = file_refresh_stat(file);
+    if (stat.size < 0)
+        return false;
+    if (stat.inode != index->inode || stat.device != index->device || stat.size < index->indexed_size)
+        line_index_reset(index, stat);
+
+    char* buf = malloc(LINE_INDEX_BUF_SIZE);
+    if (buf == NULL)
+        return false;
+    bool result = true;
+    while (index->indexed_size < stat.size) {
+        int64_t remaining = stat.size - index->indexed_size;
+        size_t size = remaining < LINE_INDEX_BUF_SIZE ? remaining : LINE_INDEX_BUF_SIZE;
+        ssize_t bytes_read = pread_full(file, buf, size, index->indexed_size);
+        if (bytes_read <= 0) {
+            // Reaching the end early means the file was truncated while it was read
+            result = bytes_read == 0;
+            break;
+        }
+        index_newlines(index, buf, bytes_read, index->indexed_size);
+        index->indexed_size += bytes_read;
+    }
+    free(buf);
+    return result;
+}
+
+int64_t file_line_index_count(FileLineIndex* index) {
+    return index->num_newlines + (index->indexed_size > index->last_line_start);
+}
+
+bool file_line_index_save(FileLineIndex* index, str path) {
+    LineIndexHeader header = {
+        .magic = LINE_INDEX_MAGIC,
+        .interval = index->interval,
+        .inode = index->inode,
+        .device = index->device,
+        .indexed_size = index->indexed_size,
+        .num_newlines = index->num_newlines,
+        .last_line_start = index->last_line_start,
+        .num_checkpoints = index->checkpoints.len
+    };
+    size_t checkpoints_size = index->checkpoints.len * sizeof(int64_t);
+    uint32_t crc = hash_crc32c_bytes(&header, sizeof(header));
+    crc = hash_crc32c_update(crc, index->checkpoints.data, checkpoints_size);
+
+    // Write to a temporary file first, so the sidecar file is never left half-written
+    dynstr temp_path = dynstr_create();
+    dynstr_append_str(&temp_path, path);
+    dynstr_append(&temp_path, ".tmp");
+    File file = file_open(dynstr_to_str(temp_path), FileWrite | FileTruncate | FileBinary);
+    if (!file_is_open(file)) {
+        dynstr_free(temp_path);
+        return false;
+    }
+    bool result = file_write_u8(&file, (uint8_t*)&header, sizeof(header)) == sizeof(header)
+               && file_write_i64(&file, index->checkpoints.data, index->checkpoints.len) == index->checkpoints.len
+               && file_write_u32(&file, &crc, 1) == 1;
+    file_close(&file);
+    if (result)
+        result = rename(temp_path.data, path.data) == 0;
+    else
+        remove(temp_path.data);
+    dynstr_free(temp_path);
+    return result;
+}
+
+Optional(FileLineIndex) file_line_index_load(str path) {
+    File file = file_open(path, FileRead | FileBinary);
+    if (!file_is_open(file))
+        return None(FileLineIndex);
+    str data = file_read_all(&file);
+    file_close(&file);
+
+    LineIndexHeader header;
+    size_t checkpoints_size = 0;
+    bool valid = data.len >= (int)(sizeof(header) + sizeof(uint32_t));
+    if (valid) {
+        memcpy(&header, data.data, sizeof(header));
+        checkpoints_size = data.len - sizeof(header) - sizeof(uint32_t);
+        uint32_t crc;
+        memcpy(&crc, data.data + data.len - sizeof(crc), sizeof(crc));
+        valid = memcmp(header.magic, LINE_INDEX_MAGIC, sizeof(header.magic)) == 0
+             && crc == hash_crc32c_bytes(data.data, data.len - sizeof(crc))
+             && header.interval > 0
+             && header.num_checkpoints == header.num_newlines / header.interval + 1
+             && checkpoints_size == header.num_checkpoints * sizeof(int64_t);
+    }
+    if (!valid) {
+        free(data.data);
+        return None(FileLineIndex);
+    }
+
+    FileLineIndex index = {
+        .checkpoints = vec_int64_t_create(),
+        .interval = header.interval,
+        .indexed_size = header.indexed_size,
+        .num_newlines = header.num_newlines,
+        .last_line_start = header.last_line_start,
+        .inode = header.inode,
+        .device = header.device
+    };
+    vec_int64_t_push_n(&index.checkpoints, (int64_t*)(data.data + sizeof(header)), header.num_checkpoints);
+    free(data.data);
+    return Some(FileLineIndex, index);
+}
+
+void file_line_index_free(FileLineIndex* index) {
+    vec_int64_t_free(index->checkpoints);
+    index->checkpoints = vec_int64_t_create();
+}
+
+bool file_seek_line(File* file, FileLineIndex* index, int64_t line) {
+    if (line < 0 || line >= file_line_index_count(index))
+        return false;
+    int64_t offset = index->checkpoints.data[line / index->interval];
+    int64_t remaining = line % index->interval;
+    char buf[LINE_SCAN_BUF_SIZE];
+    while (remaining > 0) {
+        ssize_t bytes_read = pread_full(file, buf, LINE_SCAN_BUF_SIZE, offset);
+        if (bytes_read <= 0)
+            return false;
+        char* pos = buf;
+        char* end = buf + bytes_read;
+        char* newline;
+        while (remaining > 0 && (newline = memchr(pos, '\n', end - pos)) != NULL) {
+            pos = newline + 1;
+            remaining--;
+        }
+        offset += remaining > 0 ? bytes_read : pos - buf;
+    }
+    return file_seek(file, offset, FilePositionStart);
+}
+
+Optional(str) file_read_line_at(File* file, FileLineIndex* index, int64_t line) {
+    if (!file_seek_line(file, index, line))
+        return None(str);
+    return Some(str, file_read_line(file));
+}
+
+typedef enum {
+    FollowPathSame,
+    FollowPathReplaced,
+    FollowPathMissing
+} FollowPathStatus;
+
+#ifdef __linux__
+static int64_t follow_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+static void follow_watch_file(FileFollower* follower) {
+    if (follower->file_watch >= 0)
+        inotify_rm_watch(follower->inotify_fd, follower->file_watch);
+    follower->file_watch = -1;
+    if (follower->inotify_fd >= 0)
+        follower->file_watch = inotify_add_watch(
+            follower->inotify_fd, follower->filename.data, FOLLOW_FILE_EVENTS
+        );
+}
+
+// Open the followed file, watching it before anything is read from it.
+static File follow_open_file(FileFollower* follower) {
+    follow_watch_file(follower);
+    File file = file_open(dynstr_to_str(follower->filename), FileRead | FileBinary);
+    // The file may have been created after the watch failed to find it
+    if (file_is_open(file) && follower->file_watch < 0)
+        follow_watch_file(follower);
+    return file;
+}
+
+static void follow_watch_dir(FileFollower* follower, char* dir) {
+    follower->file_watch = -1;
+    follower->dir_watch = -1;
+    follower->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (follower->inotify_fd >= 0)
+        follower->dir_watch = inotify_add_watch(follower->inotify_fd, dir, FOLLOW_DIR_EVENTS);
+}
+
+static FollowPathStatus follow_path_status(FileFollower* follower, FileStat open_stat) {
+    struct stat path_st;
+    if (stat(follower->filename.data, &path_st) != 0)
+        return FollowPathMissing;
+    if ((uint64_t)path_st.st_ino != open_stat.inode || (uint64_t)path_st.st_dev != open_stat.device)
+        return FollowPathReplaced;
+    return FollowPathSame;
+}
+
+// Wait up to `wait_ms` milliseconds (or forever if it's -1) for the file or its directory
+// to change. Returns false if waiting failed.
+static bool follow_wait(FileFollower* follower, int wait_ms) {
+    // Changes are polled for if any of the watches couldn't be added
+    bool watched = follower->inotify_fd >= 0 && follower->dir_watch >= 0
+                   && (!file_is_open(follower->file) || follower->file_watch >= 0);
+    if (!watched && (wait_ms < 0 || wait_ms > FOLLOW_POLL_MS))
+        wait_ms = FOLLOW_POLL_MS;
+    struct pollfd pfd = {.fd = follower->inotify_fd, .events = POLLIN};
+    if (poll(&pfd, 1, wait_ms) < 0 && errno != EINTR)
+        return false;
+    // The events themselves don't matter, since everything is checked again
+    char events[4096];
+    if (follower->inotify_fd >= 0)
+        while (read(follower->inotify_fd, events, sizeof(events)) > 0);
+    return true;
+}
+
+static void follow_unwatch(FileFollower* follower) {
+    if (follower->inotify_fd >= 0)
+        close(follower->inotify_fd);
+    follower->inotify_fd = -1;
+}
+#elifdef _WIN32
+typedef struct {
+    OVERLAPPED overlapped;
+    bool pending;
+    // Only received to rearm the request, since everything is checked again anyway
+    DWORD changes[1024];
+} FollowDirWatch;
+
+static int64_t follow_now_ms(void) {
+    return GetTickCount64();
+}
+
+// Open the followed file, sharing it for deletion so that it can still be rotated.
+static File follow_open_file(FileFollower* follower) {
+    File file = {0};
+    file.position = _FILE_NOT_OPEN_POS;
+    file.direct_fd = _FILE_NO_FD;
+    file.access_modes = FileRead | FileBinary;
+    HANDLE handle = CreateFileA(
+        follower->filename.data, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL
+    );
+    if (handle == INVALID_HANDLE_VALUE)
+        return file;
+    int fd = _open_osfhandle((intptr_t)handle, _O_RDONLY | _O_BINARY);
+    if (fd < 0) {
+        CloseHandle(handle);
+        return file;
+    }
+    file.ptr = _fdopen(fd, "rb");
+    if (file.ptr == NULL) {
+        _close(fd);
+        return file;
+    }
+    file.position = 0;
+    return file;
+}
+
+// Ask for the next change to the directory. Changes made between requests are buffered
+// by the system once the first request has been made.
+static void follow_request_changes(FileFollower* follower) {
+    FollowDirWatch* watch = follower->dir_watch;
+    if (watch == NULL || watch->pending)
+        return;
+    ResetEvent(watch->overlapped.hEvent);
+    watch->pending = ReadDirectoryChangesW(
+        follower->dir_handle, watch->changes, sizeof(watch->changes), FALSE, FOLLOW_DIR_CHANGES,
+        NULL, &watch->overlapped, NULL
+    );
+}
+
+static void follow_watch_dir(FileFollower* follower, char* dir) {
+    follower->dir_watch = NULL;
+    follower->dir_handle = CreateFileA(
+        dir, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+        OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL
+    );
+    if (follower->dir_handle == INVALID_HANDLE_VALUE) {
+        follower->dir_handle = NULL;
+        return;
+    }
+    FollowDirWatch* watch = calloc(1, sizeof(FollowDirWatch));
+    if (watch != NULL)
+        watch->overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (watch == NULL || watch->overlapped.hEvent == NULL) {
+        free(watch);
+        CloseHandle(follower->dir_handle);
+        follower->dir_handle = NULL;
+        return;
+    }
+    follower->dir_watch = watch;
+    follow_request_changes(follower);
+}
+
+static FollowPathStatus follow_path_status(FileFollower* follower, FileStat open_stat) {
+    // The CRT doesn't report file IDs, so they're compared through the handles
+    (void)open_stat;
+    HANDLE path_handle = CreateFileA(
+        follower->filename.data, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL
+    );
+    if (path_handle == INVALID_HANDLE_VALUE)
+        return FollowPathMissing;
+    BY_HANDLE_FILE_INFORMATION path_info, file_info;
+    bool have_path_info = GetFileInformationByHandle(path_handle, &path_info);
+    CloseHandle(path_handle);
+    HANDLE file_handle = (HANDLE)_get_osfhandle(_fileno(follower->file.ptr));
+    if (!have_path_info || !GetFileInformationByHandle(file_handle, &file_info))
+        return FollowPathSame;
+    if (path_info.dwVolumeSerialNumber != file_info.dwVolumeSerialNumber
+        || path_info.nFileIndexHigh != file_info.nFileIndexHigh
+        || path_info.nFileIndexLow != file_info.nFileIndexLow)
+        return FollowPathReplaced;
+    return FollowPathSame;
+}
+
+// Wait up to `wait_ms` milliseconds (or forever if it's -1) for the file or its directory
+// to change. Returns false if waiting failed.
+static bool follow_wait(FileFollower* follower, int wait_ms) {
+    /* Directory entries of files held open by a writer aren't always
+    updated as they grow, so changes are polled for as well. */
+    if (wait_ms < 0 || wait_ms > FOLLOW_POLL_MS)
+        wait_ms = FOLLOW_POLL_MS;
+    FollowDirWatch* watch = follower->dir_watch;
+    follow_request_changes(follower);
+    if (watch == NULL || !watch->pending) {
+        Sleep(wait_ms);
+        return true;
+    }
+    DWORD result = WaitForSingleObject(watch->overlapped.hEvent, wait_ms);
+    if (result == WAIT_OBJECT_0) {
+        DWORD num_bytes;
+        GetOverlappedResult(follower->dir_handle, &watch->overlapped, &num_bytes, FALSE);
+        watch->pending = false;
+        follow_request_changes(follower);
+    }
+    return result == WAIT_OBJECT_0 || result == WAIT_TIMEOUT;
+}
+
+static void follow_unwatch(FileFollower* follower) {
+    FollowDirWatch* watch = follower->dir_watch;
+    if (watch != NULL) {
+        // The request writes into the watch, so it has to finish before it's freed
+        if (watch->pending) {
+            DWORD num_bytes;
+            CancelIo(follower->dir_handle);
+            GetOverlappedResult(follower->dir_handle, &watch->overlapped, &num_bytes, TRUE);
+        }
+        CloseHandle(watch->overlapped.hEvent);
+        free(watch);
+    }
+    if (follower->dir_handle != NULL)
+        CloseHandle(follower->dir_handle);
+    follower->dir_watch = NULL;
+    follower->dir_handle = NULL;
+}
+#endif
+
+// (Re)open the followed file.
+static bool follow_open(FileFollower* follower) {
+    follower->file = follow_open_file(follower);
+    return file_is_open(follower->file);
+}
+
+/* End the line that the old file was in the middle of when it was rotated or truncated,
+so that it is returned on its own rather than joined to the new file's first line. */
+static void follow_end_partial(FileFollower* follower) {
+    if (follower->partial_start == follower->partial.len)
+        return;
+    if (!dynstr_append_char(&follower->partial, '\n')) {
+        dynstr_clear(&follower->partial);
+        follower->partial_start = 0;
+    }
+}
+
+/* Check whether the file at the followed path was replaced or truncated,
+reopening it if so. Returns true if there may be new data to read. */
+static bool follow_check_rotation(FileFollower* follower) {
+    if (!file_is_open(follower->file))
+        return follow_open(follower);
+
+    FileStat stat = file_refresh_stat(&follower->file);
+    if (stat.size < 0)
+        return false;
+    FollowPathStatus status = follow_path_status(follower, stat);
+    // Rotated away, with no new file created yet
+    if (status == FollowPathMissing)
+        return false;
+    if (status == FollowPathReplaced) {
+        file_close(&follower->file);
+        follow_end_partial(follower);
+        return follow_open(follower);
+    }
+    if (stat.size < follower->file.position) {
+        follow_end_partial(follower);
+        file_rewind(&follower->file);
+        return true;
+    }
+    return false;
+}
+
+FileFollower file_follow(str filename, bool from_end) {
+    FileFollower follower = {0};
+    follower.filename = dynstr_create();
+    dynstr_append_str(&follower.filename, filename);
+    follower.partial = dynstr_create();
+    follower.file.position = _FILE_NOT_OPEN_POS;
+
+    // Watch the directory for the file being (re)created
+    dynstr dir = dynstr_create();
+    char* last_slash = strrchr(follower.filename.data, '/');
+#ifdef _WIN32
+    char* last_backslash = strrchr(follower.filename.data, '\\');
+    if (last_slash == NULL || (last_backslash != NULL && last_backslash > last_slash))
+        last_slash = last_backslash;
+#endif
+    if (last_slash == NULL)
+        dynstr_append(&dir, ".");
+    else if (last_slash == follower.filename.data)
+        dynstr_append_str(&dir, (str){.data = follower.filename.data, .len = 1});
+    else
+        dynstr_append_str(&dir, (str){.data = follower.filename.data, .len = last_slash - follower.filename.data});
+    follow_watch_dir(&follower, dir.data);
+    dynstr_free(dir);
+
+    if (follow_open(&follower) && from_end)
+        file_seek(&follower.file, 0, FilePositionEnd);
+
+    return follower;
+}
+
+Optional(str) file_follow_read_line(FileFollower* follower, int timeout_ms) {
+    int64_t deadline = follow_now_ms() + timeout_ms;
+    dynstr* partial = &follower->partial;
+    int scanned = follower->partial_start;
+    while (true) {
+        // Return a complete line if one has been read already
+        char* newline = memchr(partial->data + scanned, '\n', partial->len - scanned);
+        if (newline != NULL) {
+            char* line_start = partial->data + follower->partial_start;
+            int line_len = newline - line_start;
+            char* line = malloc(line_len + 1);
+            if (line == NULL) {
+                errno = ENOMEM;
+                return None(str);
+            }
+            memcpy(line, line_start, line_len);
+            line[line_len] = '\0';
+            follower->partial_start += line_len + 1;
+            return Some(str, ((str){.data = line, .len = line_len}));
+        }
+        scanned = partial->len;
+
+        if (file_is_open(follower->file)) {
+            // Drop the lines that were already returned
+            int num_returned = follower->partial_start;
+            memmove(partial->data, partial->data + num_returned, partial->len - num_returned);
+            partial->len -= num_returned;
+            scanned -= num_returned;
+            follower->partial_start = 0;
+
+            // Read straight onto the end of the partial line
+            if (!vec_char_reserve(partial, FOLLOW_BUF_SIZE + 1)) {
+                errno = ENOMEM;
+                return None(str);
+            }
+            // Reading again after reaching the end of the file requires clearing EOF
+            clearerr(follower->file.ptr);
+            size_t bytes_read = fread(partial->data + partial->len, sizeof(char), FOLLOW_BUF_SIZE, follower->file.ptr);
+            partial->len += bytes_read;
+            partial->data[partial->len] = '\0';
+            if (bytes_read > 0) {
+                follower->file.position += bytes_read;
+                continue;
+            }
+        }
+        if (follow_check_rotation(follower)) {
+            scanned = follower->partial_start;
+            continue;
+        }
+
+        // Wait for the file or its directory to change
+        int wait_ms = -1;
+        if (timeout_ms >= 0) {
+            int64_t remaining = deadline - follow_now_ms();
+            if (remaining <= 0)
+                return None(str);
+            wait_ms = remaining;
+        }
+        if (!follow_wait(follower, wait_ms))
+            return None(str);
+    }
+}
+
+void file_follow_close(FileFollower* follower) {
+    if (file_is_open(follower->file))
+        file_close(&follower->file);
+    follow_unwatch(follower);
+    dynstr_free(follower->partial);
+    dynstr_free(follower->filename);
+}
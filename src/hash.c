@@ -0,0 +1,325 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "hash.h"
+
+// Reflected CRC32C (Castagnoli) polynomial
+#define CRC32C_POLY  0x82F63B78
+/* The hardware path checksums three blocks at once (the
+instruction has a latency of 3 cycles but a throughput of 1),
+then combines them by shifting each checksum past the blocks
+that follow it. Long blocks are used first, then short ones. */
+#define CRC32C_LONG  8192
+#define CRC32C_SHORT 256
+
+#define XXH64_PRIME_1 0x9E3779B185EBCA87ULL
+#define XXH64_PRIME_2 0xC2B2AE3D27D4EB4FULL
+#define XXH64_PRIME_3 0x165667B19E3779F9ULL
+#define XXH64_PRIME_4 0x85EBCA77C2B2AE63ULL
+#define XXH64_PRIME_5 0x27D4EB2F165667C5ULL
+#define XXH64_STRIPE  32
+
+static uint32_t crc32c_table[8][256];
+static uint32_t crc32c_long_shift[4][256];
+static uint32_t crc32c_short_shift[4][256];
+static uint32_t (*crc32c_impl)(uint32_t crc, uint8_t* data, size_t len);
+static pthread_once_t crc32c_init_once = PTHREAD_ONCE_INIT;
+
+static uint64_t load_u64_le(uint8_t* src) {
+    uint64_t value;
+    memcpy(&value, src, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+static uint32_t load_u32_le(uint8_t* src) {
+    uint32_t value;
+    memcpy(&value, src, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+// Slicing-by-8: each table entry advances a byte's contribution past 1-7 more bytes
+static uint32_t crc32c_software(uint32_t crc, uint8_t* data, size_t len) {
+    while (len >= 8) {
+        uint64_t word = load_u64_le(data) ^ crc;
+        crc = crc32c_table[7][word & 0xFF] ^ crc32c_table[6][(word >> 8) & 0xFF]
+            ^ crc32c_table[5][(word >> 16) & 0xFF] ^ crc32c_table[4][(word >> 24) & 0xFF]
+            ^ crc32c_table[3][(word >> 32) & 0xFF] ^ crc32c_table[2][(word >> 40) & 0xFF]
+            ^ crc32c_table[1][(word >> 48) & 0xFF] ^ crc32c_table[0][word >> 56];
+        data += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+        crc = crc32c_table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(__x86_64__)
+// Advance a checksum past as many zero bytes as `table` was built for
+static uint32_t crc32c_shift(uint32_t table[4][256], uint32_t crc) {
+    return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^ table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hardware(uint32_t crc, uint8_t* data, size_t len) {
+    uint64_t crc0 = crc;
+    while (len > 0 && ((uintptr_t)data & 7) != 0) {
+        crc0 = _mm_crc32_u8(crc0, *data++);
+        len--;
+    }
+
+    while (len >= CRC32C_LONG * 3) {
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        uint8_t* end = data + CRC32C_LONG;
+        do {
+            crc0 = _mm_crc32_u64(crc0, load_u64_le(data));
+            crc1 = _mm_crc32_u64(crc1, load_u64_le(data + CRC32C_LONG));
+            crc2 = _mm_crc32_u64(crc2, load_u64_le(data + CRC32C_LONG * 2));
+            data += 8;
+        } while (data < end);
+        crc0 = crc32c_shift(crc32c_long_shift, crc0) ^ crc1;
+        crc0 = crc32c_shift(crc32c_long_shift, crc0) ^ crc2;
+        data += CRC32C_LONG * 2;
+        len -= CRC32C_LONG * 3;
+    }
+
+    while (len >= CRC32C_SHORT * 3) {
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        uint8_t* end = data + CRC32C_SHORT;
+        do {
+            crc0 = _mm_crc32_u64(crc0, load_u64_le(data));
+            crc1 = _mm_crc32_u64(crc1, load_u64_le(data + CRC32C_SHORT));
+            crc2 = _mm_crc32_u64(crc2, load_u64_le(data + CRC32C_SHORT * 2));
+            data += 8;
+        } while (data < end);
+        crc0 = crc32c_shift(crc32c_short_shift, crc0) ^ crc1;
+        crc0 = crc32c_shift(crc32c_short_shift, crc0) ^ crc2;
+        data += CRC32C_SHORT * 2;
+        len -= CRC32C_SHORT * 3;
+    }
+
+    while (len >= 8) {
+        crc0 = _mm_crc32_u64(crc0, load_u64_le(data));
+        data += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+        crc0 = _mm_crc32_u8(crc0, *data++);
+    return crc0;
+}
+#endif
+
+/* A CRC register advanced past zero bytes is a linear map over
+GF(2), represented as 32 columns (the image of each bit). */
+static uint32_t gf2_matrix_times(uint32_t* matrix, uint32_t vector) {
+    uint32_t sum = 0;
+    for (; vector != 0; vector >>= 1, matrix++) {
+        if (vector & 1)
+            sum ^= *matrix;
+    }
+    return sum;
+}
+
+static void gf2_matrix_square(uint32_t* square, uint32_t* matrix) {
+    for (int i = 0; i < 32; i++)
+        square[i] = gf2_matrix_times(matrix, matrix[i]);
+}
+
+// Build the tables for advancing a checksum past `len` zero bytes
+static void crc32c_init_shift(uint32_t table[4][256], size_t len) {
+    uint32_t even[32];
+    uint32_t odd[32];
+    // The operator for a single zero bit
+    odd[0] = CRC32C_POLY;
+    for (int i = 1; i < 32; i++)
+        odd[i] = 1U << (i - 1);
+    // Square it up to one zero byte
+    gf2_matrix_square(even, odd);
+    gf2_matrix_square(odd, even);
+    gf2_matrix_square(even, odd);
+    uint32_t* op = even;
+    uint32_t* spare = odd;
+    // `len` is a power of two, so the byte operator is squared log2(len) times
+    for (; len > 1; len >>= 1) {
+        gf2_matrix_square(spare, op);
+        uint32_t* tmp = op;
+        op = spare;
+        spare = tmp;
+    }
+
+    for (uint32_t i = 0; i < 256; i++) {
+        table[0][i] = gf2_matrix_times(op, i);
+        table[1][i] = gf2_matrix_times(op, i << 8);
+        table[2][i] = gf2_matrix_times(op, i << 16);
+        table[3][i] = gf2_matrix_times(op, i << 24);
+    }
+}
+
+static void crc32c_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ (CRC32C_POLY & -(crc & 1));
+        crc32c_table[0][i] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int i = 0; i < 256; i++)
+            crc32c_table[k][i] = (crc32c_table[k - 1][i] >> 8) ^ crc32c_table[0][crc32c_table[k - 1][i] & 0xFF];
+    }
+
+    crc32c_impl = crc32c_software;
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32c_init_shift(crc32c_long_shift, CRC32C_LONG);
+        crc32c_init_shift(crc32c_short_shift, CRC32C_SHORT);
+        crc32c_impl = crc32c_hardware;
+    }
+#endif
+}
+
+uint32_t hash_crc32c_update(uint32_t crc, void* data, size_t len) {
+    pthread_once(&crc32c_init_once, crc32c_init);
+    return ~crc32c_impl(~crc, data, len);
+}
+
+uint32_t hash_crc32c_bytes(void* data, size_t len) {
+    return hash_crc32c_update(0, data, len);
+}
+
+static uint64_t rotl64(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH64_PRIME_2;
+    acc = rotl64(acc, 31);
+    return acc * XXH64_PRIME_1;
+}
+
+static uint64_t xxh64_merge_round(uint64_t hash, uint64_t acc) {
+    hash ^= xxh64_round(0, acc);
+    return hash * XXH64_PRIME_1 + XXH64_PRIME_4;
+}
+
+static void xxh64_init(uint64_t acc[4], uint64_t seed) {
+    acc[0] = seed + XXH64_PRIME_1 + XXH64_PRIME_2;
+    acc[1] = seed + XXH64_PRIME_2;
+    acc[2] = seed;
+    acc[3] = seed - XXH64_PRIME_1;
+}
+
+// Consume as many whole stripes as `len` holds, returning how many bytes were consumed
+static size_t xxh64_stripes(uint64_t acc[4], uint8_t* data, size_t len) {
+    size_t consumed = 0;
+    // Locals keep the accumulators in registers
+    uint64_t acc0 = acc[0], acc1 = acc[1], acc2 = acc[2], acc3 = acc[3];
+    for (; len - consumed >= XXH64_STRIPE; consumed += XXH64_STRIPE) {
+        acc0 = xxh64_round(acc0, load_u64_le(data + consumed));
+        acc1 = xxh64_round(acc1, load_u64_le(data + consumed + 8));
+        acc2 = xxh64_round(acc2, load_u64_le(data + consumed + 16));
+        acc3 = xxh64_round(acc3, load_u64_le(data + consumed + 24));
+    }
+    acc[0] = acc0;
+    acc[1] = acc1;
+    acc[2] = acc2;
+    acc[3] = acc3;
+    return consumed;
+}
+
+// Mix the accumulators and the trailing (less than a stripe of) bytes into the digest
+static uint64_t xxh64_finish(uint64_t acc[4], uint64_t seed, uint64_t total_len, uint8_t* tail, size_t len) {
+    uint64_t hash;
+    if (total_len >= XXH64_STRIPE) {
+        hash = rotl64(acc[0], 1) + rotl64(acc[1], 7) + rotl64(acc[2], 12) + rotl64(acc[3], 18);
+        for (int i = 0; i < 4; i++)
+            hash = xxh64_merge_round(hash, acc[i]);
+    }
+    else
+        hash = seed + XXH64_PRIME_5;
+    hash += total_len;
+
+    for (; len >= 8; tail += 8, len -= 8) {
+        hash ^= xxh64_round(0, load_u64_le(tail));
+        hash = rotl64(hash, 27) * XXH64_PRIME_1 + XXH64_PRIME_4;
+    }
+    if (len >= 4) {
+        hash ^= (uint64_t)load_u32_le(tail) * XXH64_PRIME_1;
+        hash = rotl64(hash, 23) * XXH64_PRIME_2 + XXH64_PRIME_3;
+        tail += 4;
+        len -= 4;
+    }
+    for (; len > 0; tail++, len--) {
+        hash ^= *tail * XXH64_PRIME_5;
+        hash = rotl64(hash, 11) * XXH64_PRIME_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH64_PRIME_2;
+    hash ^= hash >> 29;
+    hash *= XXH64_PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t hash_xxh64_bytes(void* data, size_t len, uint64_t seed) {
+    uint64_t acc[4];
+    xxh64_init(acc, seed);
+    size_t consumed = xxh64_stripes(acc, data, len);
+    return xxh64_finish(acc, seed, len, (uint8_t*)data + consumed, len - consumed);
+}
+
+Hasher hasher_create(HashAlgorithm algorithm, uint64_t seed) {
+    Hasher hasher = {.algorithm = algorithm, .seed = seed};
+    xxh64_init(hasher.acc, seed);
+    return hasher;
+}
+
+void hasher_update(Hasher* hasher, void* data, size_t len) {
+    if (hasher->algorithm == HashCrc32c) {
+        hasher->crc = hash_crc32c_update(hasher->crc, data, len);
+        return;
+    }
+
+    uint8_t* bytes = data;
+    hasher->total_len += len;
+    // Top up a partial stripe first
+    if (hasher->stripe_len > 0) {
+        size_t fill = XXH64_STRIPE - hasher->stripe_len;
+        if (fill > len)
+            fill = len;
+        memcpy(hasher->stripe + hasher->stripe_len, bytes, fill);
+        hasher->stripe_len += fill;
+        bytes += fill;
+        len -= fill;
+        if (hasher->stripe_len < XXH64_STRIPE)
+            return;
+        xxh64_stripes(hasher->acc, hasher->stripe, XXH64_STRIPE);
+        hasher->stripe_len = 0;
+    }
+    size_t consumed = xxh64_stripes(hasher->acc, bytes, len);
+    memcpy(hasher->stripe, bytes + consumed, len - consumed);
+    hasher->stripe_len = len - consumed;
+}
+
+uint64_t hasher_digest(Hasher* hasher) {
+    if (hasher->algorithm == HashCrc32c)
+        return hasher->crc;
+    return xxh64_finish(hasher->acc, hasher->seed, hasher->total_len, hasher->stripe, hasher->stripe_len);
+}
+
+void hasher_reset(Hasher* hasher) {
+    *hasher = hasher_create(hasher->algorithm, hasher->seed);
+}
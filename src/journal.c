@@ -0,0 +1,426 @@
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#elifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#endif
+
+#include "journal.h"
+#include "file.h"
+#include "hash.h"
+#include "str.h"
+
+// Length prefix + checksum
+#define RECORD_HEADER_SIZE 8
+// Records longer than this are treated as corrupt when read
+#define MAX_RECORD_SIZE    (1 << 30)
+#define NO_FAILURE         UINT64_MAX
+
+#ifdef __linux__
+typedef pthread_mutex_t JournalLock;
+typedef pthread_cond_t  JournalCond;
+typedef pthread_t       JournalThread;
+#elifdef _WIN32
+typedef SRWLOCK            JournalLock;
+typedef CONDITION_VARIABLE JournalCond;
+typedef HANDLE             JournalThread;
+#endif
+
+struct Journal {
+    File file;
+    JournalOptions options;
+    JournalLock lock;
+    //\ Signalled when the committer has work to do.
+    JournalCond batch_ready;
+    //\ Broadcast whenever a batch has been committed.
+    JournalCond committed;
+    //\ Broadcast whenever the pending batch is taken for a commit.
+    JournalCond pending_taken;
+    JournalThread committer;
+    //\ Framed records waiting to be committed, and the buffer
+    //\ that the previous batch was written from.
+    dynstr pending;
+    dynstr writing;
+    int64_t pending_since_ns;
+    //\ Ticket of the first record in the pending batch, and
+    //\ for the next appended record. Every record with a
+    //\ ticket below `durable_ticket` has been committed, and
+    //\ every record from `failed_ticket` on failed to commit.
+    uint64_t pending_ticket;
+    uint64_t next_ticket;
+    uint64_t durable_ticket;
+    uint64_t failed_ticket;
+    bool closing;
+};
+
+static void put_u32_le(char* dst, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        dst[i] = (value >> (i * 8)) & 0xFF;
+}
+
+static uint32_t get_u32_le(uint8_t* src) {
+    return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static int64_t monotonic_ns(void) {
+#ifdef __linux__
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+#elifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    // Split up so that the multiplication can't overflow
+    int64_t seconds = counter.QuadPart / frequency.QuadPart;
+    int64_t remainder = counter.QuadPart % frequency.QuadPart;
+    return seconds * 1000000000LL + remainder * 1000000000LL / frequency.QuadPart;
+#endif
+}
+
+static void lock_init(JournalLock* lock) {
+#ifdef __linux__
+    pthread_mutex_init(lock, NULL);
+#elifdef _WIN32
+    InitializeSRWLock(lock);
+#endif
+}
+
+static void lock_destroy(JournalLock* lock) {
+#ifdef __linux__
+    pthread_mutex_destroy(lock);
+#elifdef _WIN32
+    (void)lock;
+#endif
+}
+
+static void lock_acquire(JournalLock* lock) {
+#ifdef __linux__
+    pthread_mutex_lock(lock);
+#elifdef _WIN32
+    AcquireSRWLockExclusive(lock);
+#endif
+}
+
+static void lock_release(JournalLock* lock) {
+#ifdef __linux__
+    pthread_mutex_unlock(lock);
+#elifdef _WIN32
+    ReleaseSRWLockExclusive(lock);
+#endif
+}
+
+static void cond_init(JournalCond* cond) {
+#ifdef __linux__
+    // Deadlines come from monotonic_ns()
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+#elifdef _WIN32
+    InitializeConditionVariable(cond);
+#endif
+}
+
+static void cond_destroy(JournalCond* cond) {
+#ifdef __linux__
+    pthread_cond_destroy(cond);
+#elifdef _WIN32
+    (void)cond;
+#endif
+}
+
+static void cond_wait(JournalCond* cond, JournalLock* lock) {
+#ifdef __linux__
+    pthread_cond_wait(cond, lock);
+#elifdef _WIN32
+    SleepConditionVariableSRW(cond, lock, INFINITE, 0);
+#endif
+}
+
+// Wait on `cond` until it is signalled or `deadline_ns` (from monotonic_ns()) passes
+static void cond_wait_until(JournalCond* cond, JournalLock* lock, int64_t deadline_ns) {
+#ifdef __linux__
+    struct timespec deadline = {.tv_sec = deadline_ns / 1000000000LL, .tv_nsec = deadline_ns % 1000000000LL};
+    pthread_cond_timedwait(cond, lock, &deadline);
+#elifdef _WIN32
+    int64_t remaining_ns = deadline_ns - monotonic_ns();
+    if (remaining_ns > 0)
+        SleepConditionVariableSRW(cond, lock, (DWORD)((remaining_ns + 999999) / 1000000), 0);
+#endif
+}
+
+static void cond_signal(JournalCond* cond) {
+#ifdef __linux__
+    pthread_cond_signal(cond);
+#elifdef _WIN32
+    WakeConditionVariable(cond);
+#endif
+}
+
+static void cond_broadcast(JournalCond* cond) {
+#ifdef __linux__
+    pthread_cond_broadcast(cond);
+#elifdef _WIN32
+    WakeAllConditionVariable(cond);
+#endif
+}
+
+static bool write_all(File* file, char* data, size_t size) {
+#ifdef __linux__
+    int fd = fileno(file->ptr);
+    size_t total = 0;
+    while (total < size) {
+        ssize_t bytes_written = write(fd, data + total, size - total);
+        if (bytes_written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        total += bytes_written;
+    }
+    return true;
+#elifdef _WIN32
+    HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file->ptr));
+    size_t total = 0;
+    while (total < size) {
+        // The runtime only emulates append mode, so ask for the end of the file explicitly
+        OVERLAPPED overlapped = {.Offset = 0xFFFFFFFF, .OffsetHigh = 0xFFFFFFFF};
+        DWORD chunk = size - total > 0x40000000 ? 0x40000000 : (DWORD)(size - total);
+        DWORD bytes_written = 0;
+        if (!WriteFile(handle, data + total, chunk, &bytes_written, &overlapped) || bytes_written == 0)
+            return false;
+        total += bytes_written;
+    }
+    return true;
+#endif
+}
+
+static bool sync_file(File* file) {
+#ifdef __linux__
+    return fdatasync(fileno(file->ptr)) == 0;
+#elifdef _WIN32
+    return FlushFileBuffers((HANDLE)_get_osfhandle(_fileno(file->ptr)));
+#endif
+}
+
+static void journal_commit_loop(Journal* journal) {
+    lock_acquire(&journal->lock);
+    while (true) {
+        while (journal->next_ticket == journal->pending_ticket && !journal->closing)
+            cond_wait(&journal->batch_ready, &journal->lock);
+        if (journal->next_ticket == journal->pending_ticket)
+            break;
+
+        // Give the batch time to fill up, unless it's already full
+        int64_t deadline = journal->pending_since_ns + journal->options.max_latency_us * 1000;
+        while (journal->pending.len < journal->options.max_batch_bytes && !journal->closing
+               && monotonic_ns() < deadline)
+            cond_wait_until(&journal->batch_ready, &journal->lock, deadline);
+
+        // Swap buffers so that appends can continue during the commit
+        dynstr batch = journal->pending;
+        journal->pending = journal->writing;
+        dynstr_clear(&journal->pending);
+        journal->writing = batch;
+        cond_broadcast(&journal->pending_taken);
+        uint64_t batch_start = journal->pending_ticket;
+        uint64_t batch_end = journal->next_ticket;
+        journal->pending_ticket = batch_end;
+        // Nothing is written after a failure, so the file never has gaps
+        bool failed = journal->failed_ticket != NO_FAILURE;
+        lock_release(&journal->lock);
+
+        if (!failed)
+            failed = !write_all(&journal->file, batch.data, batch.len) || !sync_file(&journal->file);
+
+        lock_acquire(&journal->lock);
+        if (failed && journal->failed_ticket == NO_FAILURE)
+            journal->failed_ticket = batch_start;
+        journal->durable_ticket = batch_end;
+        cond_broadcast(&journal->committed);
+    }
+    lock_release(&journal->lock);
+}
+
+#ifdef __linux__
+static void* journal_committer(void* arg) {
+    journal_commit_loop(arg);
+    return NULL;
+}
+#elifdef _WIN32
+static DWORD WINAPI journal_committer(void* arg) {
+    journal_commit_loop(arg);
+    return 0;
+}
+#endif
+
+static bool journal_start_committer(Journal* journal) {
+#ifdef __linux__
+    return pthread_create(&journal->committer, NULL, journal_committer, journal) == 0;
+#elifdef _WIN32
+    journal->committer = CreateThread(NULL, 0, journal_committer, journal, 0, NULL);
+    return journal->committer != NULL;
+#endif
+}
+
+static void journal_join_committer(Journal* journal) {
+#ifdef __linux__
+    pthread_join(journal->committer, NULL);
+#elifdef _WIN32
+    WaitForSingleObject(journal->committer, INFINITE);
+    CloseHandle(journal->committer);
+#endif
+}
+
+static void journal_free(Journal* journal) {
+    lock_destroy(&journal->lock);
+    cond_destroy(&journal->pending_taken);
+    cond_destroy(&journal->committed);
+    cond_destroy(&journal->batch_ready);
+    dynstr_free(journal->writing);
+    dynstr_free(journal->pending);
+    file_close(&journal->file);
+    free(journal);
+}
+
+Journal* journal_open(str filename, JournalOptions options) {
+    Journal* journal = calloc(1, sizeof(Journal));
+    if (journal == NULL)
+        return NULL;
+
+    journal->file = file_open(filename, FileAppend | FileBinary);
+    if (!file_is_open(journal->file)) {
+        free(journal);
+        return NULL;
+    }
+    // Records are written straight to the descriptor
+    setvbuf(journal->file.ptr, NULL, _IONBF, 0);
+
+    if (options.max_pending_bytes <= 0)
+        options.max_pending_bytes = 4 * options.max_batch_bytes;
+    journal->options = options;
+    journal->pending = dynstr_create();
+    journal->writing = dynstr_create();
+    journal->pending_ticket = 0;
+    journal->next_ticket = 0;
+    journal->durable_ticket = 0;
+    journal->failed_ticket = NO_FAILURE;
+
+    cond_init(&journal->batch_ready);
+    cond_init(&journal->committed);
+    cond_init(&journal->pending_taken);
+    lock_init(&journal->lock);
+
+    if (!journal_start_committer(journal)) {
+        journal_free(journal);
+        return NULL;
+    }
+
+    return journal;
+}
+
+uint64_t journal_append(Journal* journal, str record) {
+    bool valid = record.len >= 0 && record.len <= MAX_RECORD_SIZE;
+    char header[RECORD_HEADER_SIZE];
+    put_u32_le(header, valid ? record.len : 0);
+    // Checksums are computed outside of the lock
+    put_u32_le(header + 4, valid ? hash_crc32c(record) : 0);
+
+    lock_acquire(&journal->lock);
+    // Wait for the committer to take the batch if this record doesn't fit
+    while (journal->pending.len > 0
+           && (int64_t)journal->pending.len + RECORD_HEADER_SIZE + record.len > journal->options.max_pending_bytes) {
+        cond_signal(&journal->batch_ready);
+        cond_wait(&journal->pending_taken, &journal->lock);
+    }
+    bool was_empty = journal->next_ticket == journal->pending_ticket;
+    if (was_empty)
+        journal->pending_since_ns = monotonic_ns();
+    int old_len = journal->pending.len;
+    if (!valid || !dynstr_append_str(&journal->pending, (str){.data = header, .len = RECORD_HEADER_SIZE})
+        || !dynstr_append_str(&journal->pending, record)) {
+        // Fail the whole batch, since committing the rest of it would leave a gap in the file
+        journal->pending.len = old_len;
+        if (journal->failed_ticket > journal->pending_ticket)
+            journal->failed_ticket = journal->pending_ticket;
+    }
+    uint64_t ticket = journal->next_ticket++;
+    if (was_empty || journal->pending.len >= journal->options.max_batch_bytes)
+        cond_signal(&journal->batch_ready);
+    lock_release(&journal->lock);
+
+    return ticket;
+}
+
+bool journal_wait(Journal* journal, uint64_t ticket) {
+    lock_acquire(&journal->lock);
+    while (journal->durable_ticket <= ticket)
+        cond_wait(&journal->committed, &journal->lock);
+    bool durable = ticket < journal->failed_ticket;
+    lock_release(&journal->lock);
+    return durable;
+}
+
+bool journal_is_durable(Journal* journal, uint64_t ticket) {
+    lock_acquire(&journal->lock);
+    bool durable = journal->durable_ticket > ticket && ticket < journal->failed_ticket;
+    lock_release(&journal->lock);
+    return durable;
+}
+
+int64_t journal_pending_bytes(Journal* journal) {
+    lock_acquire(&journal->lock);
+    int64_t pending_bytes = journal->pending.len;
+    lock_release(&journal->lock);
+    return pending_bytes;
+}
+
+bool journal_append_sync(Journal* journal, str record) {
+    return journal_wait(journal, journal_append(journal, record));
+}
+
+bool journal_close(Journal* journal) {
+    lock_acquire(&journal->lock);
+    journal->closing = true;
+    cond_signal(&journal->batch_ready);
+    lock_release(&journal->lock);
+    journal_join_committer(journal);
+
+    bool succeeded = journal->failed_ticket == NO_FAILURE;
+    journal_free(journal);
+    return succeeded;
+}
+
+Optional(str) journal_read_record(File* file) {
+    uint8_t header[RECORD_HEADER_SIZE];
+    if (file_read_u8(file, header, RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE)
+        return None(str);
+
+    uint32_t len = get_u32_le(header);
+    uint32_t checksum = get_u32_le(header + 4);
+    if (len > MAX_RECORD_SIZE)
+        return None(str);
+
+    str record = file_read_str(file, len);
+    if (record.len != (int)len || hash_crc32c(record) != checksum) {
+        free(record.data);
+        return None(str);
+    }
+
+    return Some(str, record);
+}
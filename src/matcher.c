@@ -0,0 +1,341 @@
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "matcher.h"
+#include "file.h"
+#include "str.h"
+#include "vec.h"
+
+#define ROOT_STATE       0
+#define ROOT_CHECK      -2
+#define FREE_CELL       -1
+#define NO_STATE        -1
+#define STREAM_BUF_SIZE 65536
+
+/* The automaton is first built as a linked trie, which is
+then laid out into the double-array by breadth-first search. */
+typedef struct {
+    int32_t first_child;
+    int32_t next_sibling;
+    int32_t cell;
+    int32_t pattern;
+    uint8_t byte;
+} TrieNode;
+
+DEFINE_VEC(TrieNode)
+
+static int32_t trie_find_child(Vec(TrieNode)* trie, int32_t node, uint8_t byte) {
+    for (int32_t child = trie->data[node].first_child; child != NO_STATE;
+         child = trie->data[child].next_sibling) {
+        if (trie->data[child].byte == byte)
+            return child;
+    }
+    return NO_STATE;
+}
+
+// Add a child to a trie node, returning NO_STATE if memory couldn't be allocated.
+static int32_t trie_add_child(Vec(TrieNode)* trie, int32_t node, uint8_t byte) {
+    TrieNode child = {
+        .first_child = NO_STATE,
+        .next_sibling = trie->data[node].first_child,
+        .cell = NO_STATE,
+        .pattern = NO_STATE,
+        .byte = byte
+    };
+    if (!vec_TrieNode_push(trie, child))
+        return NO_STATE;
+    trie->data[node].first_child = trie->len - 1;
+    return trie->len - 1;
+}
+
+static bool matcher_grow_cells(Matcher* matcher, int min_cells) {
+    if (min_cells <= matcher->num_cells)
+        return true;
+    int new_num_cells = matcher->num_cells > 0 ? matcher->num_cells : 256;
+    while (new_num_cells < min_cells)
+        new_num_cells *= 2;
+
+    MatcherCell* new_cells = realloc(matcher->cells, new_num_cells * sizeof(MatcherCell));
+    if (new_cells == NULL)
+        return false;
+    for (int i = matcher->num_cells; i < new_num_cells; i++)
+        new_cells[i] = (MatcherCell){.base = 0, .check = FREE_CELL};
+
+    matcher->cells = new_cells;
+    matcher->num_cells = new_num_cells;
+    return true;
+}
+
+static inline int32_t matcher_goto(Matcher* matcher, int32_t state, uint8_t byte) {
+    int32_t next = matcher->cells[state].base + byte;
+    if (next < matcher->num_cells && matcher->cells[next].check == state)
+        return next;
+    return NO_STATE;
+}
+
+static inline int32_t matcher_step(Matcher* matcher, int32_t state, uint8_t byte) {
+    byte = matcher->fold[byte];
+    while (true) {
+        int32_t next = matcher_goto(matcher, state, byte);
+        if (next != NO_STATE)
+            return next;
+        if (state == ROOT_STATE)
+            return ROOT_STATE;
+        state = matcher->fail[state];
+    }
+}
+
+/* Place a node's children into free cells, returning
+false if memory for the cells couldn't be allocated */
+static bool matcher_place_children(Matcher* matcher, Vec(TrieNode)* trie, int32_t node, int* first_free) {
+    uint8_t bytes[256];
+    int num_children = 0;
+    for (int32_t child = trie->data[node].first_child; child != NO_STATE;
+         child = trie->data[child].next_sibling)
+        bytes[num_children++] = trie->data[child].byte;
+    if (num_children == 0)
+        return true;
+
+    uint8_t min_byte = 255;
+    for (int i = 0; i < num_children; i++) {
+        if (bytes[i] < min_byte)
+            min_byte = bytes[i];
+    }
+
+    // Skip past the densely filled cells at the start of the array
+    while (*first_free < matcher->num_cells && matcher->cells[*first_free].check != FREE_CELL)
+        (*first_free)++;
+
+    /* A base of 0 is reserved for states without children,
+    so that their lookups can never land on a used cell */
+    int32_t base = *first_free - min_byte;
+    if (base < 1)
+        base = 1;
+    while (true) {
+        if (!matcher_grow_cells(matcher, base + 256))
+            return false;
+        bool fits = true;
+        for (int i = 0; i < num_children; i++) {
+            if (matcher->cells[base + bytes[i]].check != FREE_CELL) {
+                fits = false;
+                break;
+            }
+        }
+        if (fits)
+            break;
+        base++;
+    }
+
+    int32_t cell = trie->data[node].cell;
+    matcher->cells[cell].base = base;
+    for (int32_t child = trie->data[node].first_child; child != NO_STATE;
+         child = trie->data[child].next_sibling) {
+        int32_t child_cell = base + trie->data[child].byte;
+        matcher->cells[child_cell].check = cell;
+        trie->data[child].cell = child_cell;
+    }
+    return true;
+}
+
+Matcher matcher_create(str_arr patterns, MatcherOptions options) {
+    Matcher matcher = {0};
+    Vec(TrieNode) trie = vec_TrieNode_create();
+    Vec(int32_t) queue = vec_int32_t_create();
+
+    for (int i = 0; i < 256; i++) {
+        if ((options & MatcherCaseInsensitive) && i >= 'A' && i <= 'Z')
+            matcher.fold[i] = i + ' ';
+        else
+            matcher.fold[i] = i;
+    }
+
+    matcher.num_patterns = patterns.len;
+    matcher.pattern_lens = malloc(sizeof(int) * (patterns.len > 0 ? patterns.len : 1));
+    matcher.pattern_next = malloc(sizeof(int32_t) * (patterns.len > 0 ? patterns.len : 1));
+    if (matcher.pattern_lens == NULL || matcher.pattern_next == NULL)
+        goto fail;
+
+    // Build the linked trie
+    bool pushed = vec_TrieNode_push(&trie, (TrieNode){
+        .first_child = NO_STATE,
+        .next_sibling = NO_STATE,
+        .cell = ROOT_STATE,
+        .pattern = NO_STATE
+    });
+    if (!pushed)
+        goto fail;
+    for (int i = 0; i < patterns.len; i++) {
+        str pattern = patterns.data[i];
+        matcher.pattern_lens[i] = pattern.len;
+        matcher.pattern_next[i] = NO_STATE;
+        if (pattern.len == 0)
+            continue;
+
+        int32_t node = 0;
+        for (int j = 0; j < pattern.len; j++) {
+            uint8_t byte = matcher.fold[(uint8_t)pattern.data[j]];
+            int32_t child = trie_find_child(&trie, node, byte);
+            if (child == NO_STATE)
+                child = trie_add_child(&trie, node, byte);
+            if (child == NO_STATE)
+                goto fail;
+            node = child;
+        }
+        // Identical patterns are chained together
+        matcher.pattern_next[i] = trie.data[node].pattern;
+        trie.data[node].pattern = i;
+    }
+
+    // Lay the trie out into the double-array, breadth-first
+    if (!vec_int32_t_reserve(&queue, trie.len) || !matcher_grow_cells(&matcher, 256))
+        goto fail;
+    matcher.cells[ROOT_STATE].check = ROOT_CHECK;
+    int first_free = 1;
+    vec_int32_t_push(&queue, 0);
+    for (int head = 0; head < queue.len; head++) {
+        int32_t node = queue.data[head];
+        if (!matcher_place_children(&matcher, &trie, node, &first_free))
+            goto fail;
+        // Every node is queued once, and the queue has room for all of them
+        for (int32_t child = trie.data[node].first_child; child != NO_STATE;
+             child = trie.data[child].next_sibling)
+            vec_int32_t_push(&queue, child);
+    }
+
+    matcher.fail = malloc(sizeof(int32_t) * matcher.num_cells);
+    matcher.output = malloc(sizeof(int32_t) * matcher.num_cells);
+    matcher.output_link = malloc(sizeof(int32_t) * matcher.num_cells);
+    if (matcher.fail == NULL || matcher.output == NULL || matcher.output_link == NULL)
+        goto fail;
+    for (int i = 0; i < matcher.num_cells; i++) {
+        matcher.fail[i] = ROOT_STATE;
+        matcher.output[i] = NO_STATE;
+        matcher.output_link[i] = NO_STATE;
+    }
+
+    /* Compute failure links in the same breadth-first order,
+    so that every shallower state's links are already known */
+    for (int head = 0; head < queue.len; head++) {
+        int32_t node = queue.data[head];
+        int32_t cell = trie.data[node].cell;
+        matcher.output[cell] = trie.data[node].pattern;
+        for (int32_t child = trie.data[node].first_child; child != NO_STATE;
+             child = trie.data[child].next_sibling) {
+            int32_t child_cell = trie.data[child].cell;
+            int32_t fail = ROOT_STATE;
+            if (cell != ROOT_STATE)
+                fail = matcher_step(&matcher, matcher.fail[cell], trie.data[child].byte);
+            matcher.fail[child_cell] = fail;
+        }
+    }
+    // Output links need the failure state's output, so they're linked in a second pass
+    for (int head = 1; head < queue.len; head++) {
+        int32_t cell = trie.data[queue.data[head]].cell;
+        int32_t fail = matcher.fail[cell];
+        matcher.output_link[cell] =
+            matcher.output[fail] != NO_STATE ? fail : matcher.output_link[fail];
+    }
+
+    vec_int32_t_free(queue);
+    vec_TrieNode_free(trie);
+    return matcher;
+
+fail:
+    vec_int32_t_free(queue);
+    vec_TrieNode_free(trie);
+    matcher_free(&matcher);
+    return matcher;
+}
+
+bool matcher_is_valid(Matcher matcher) {
+    return matcher.cells != NULL;
+}
+
+void matcher_free(Matcher* matcher) {
+    free(matcher->cells);
+    free(matcher->fail);
+    free(matcher->output);
+    free(matcher->output_link);
+    free(matcher->pattern_next);
+    free(matcher->pattern_lens);
+    *matcher = (Matcher){0};
+}
+
+static inline void matcher_report(Matcher* matcher, int32_t state, int64_t end, match_arr* matches) {
+    if (matcher->output[state] == NO_STATE)
+        state = matcher->output_link[state];
+    for (; state != NO_STATE; state = matcher->output_link[state]) {
+        for (int32_t id = matcher->output[state]; id != NO_STATE; id = matcher->pattern_next[id]) {
+            Match match = {
+                .pattern_id = id,
+                .len = matcher->pattern_lens[id],
+                .offset = end - matcher->pattern_lens[id]
+            };
+            vec_Match_push(matches, match);
+        }
+    }
+}
+
+match_arr matcher_find_all(Matcher* matcher, str text) {
+    MatchStream stream = matcher_stream_create(matcher);
+    match_arr matches = vec_Match_create();
+    matcher_stream_feed(&stream, text, &matches);
+    return matches;
+}
+
+bool matcher_contains_any(Matcher* matcher, str text) {
+    if (!matcher_is_valid(*matcher))
+        return false;
+    int32_t state = ROOT_STATE;
+    for (int i = 0; i < text.len; i++) {
+        state = matcher_step(matcher, state, text.data[i]);
+        if (matcher->output[state] != NO_STATE || matcher->output_link[state] != NO_STATE)
+            return true;
+    }
+    return false;
+}
+
+MatchStream matcher_stream_create(Matcher* matcher) {
+    return (MatchStream){
+        .matcher = matcher,
+        .state = ROOT_STATE,
+        .offset = 0
+    };
+}
+
+void matcher_stream_feed(MatchStream* stream, str chunk, match_arr* matches) {
+    Matcher* matcher = stream->matcher;
+    if (!matcher_is_valid(*matcher))
+        return;
+    int32_t state = stream->state;
+    for (int i = 0; i < chunk.len; i++) {
+        state = matcher_step(matcher, state, chunk.data[i]);
+        if (matcher->output[state] != NO_STATE || matcher->output_link[state] != NO_STATE)
+            matcher_report(matcher, state, stream->offset + i + 1, matches);
+    }
+    stream->state = state;
+    stream->offset += chunk.len;
+}
+
+match_arr matcher_find_all_in_file(Matcher* matcher, File* file) {
+    match_arr matches = vec_Match_create();
+    MatchStream stream = matcher_stream_create(matcher);
+    // Report absolute positions in the file
+    stream.offset = file_get_position(*file);
+
+    str chunk;
+    while ((chunk = file_read_str(file, STREAM_BUF_SIZE)).len > 0) {
+        matcher_stream_feed(&stream, chunk, &matches);
+        free(chunk.data);
+    }
+    free(chunk.data);
+    return matches;
+}
@@ -0,0 +1,357 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elifdef _WIN32
+#include <malloc.h>
+#include <windows.h>
+#endif
+
+#include "ring.h"
+#include "str.h"
+
+#define MAX_CAPACITY (1 << 30)
+// How many times a waiting thread checks the ring before sleeping on a futex
+#define SPIN_COUNT   128
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+static void futex_wait(_Atomic uint32_t* word, uint32_t expected) {
+#ifdef __linux__
+    // Returns straight away if the word has changed since it was read
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#elifdef _WIN32
+    // Same as above; spurious wakeups are fine, since the caller checks the ring again
+    WaitOnAddress((volatile void*)word, &expected, sizeof(expected), INFINITE);
+#endif
+}
+
+static void futex_wake_all(_Atomic uint32_t* word) {
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#elifdef _WIN32
+    WakeByAddressAll((void*)word);
+#endif
+}
+
+// Wake threads waiting on `word` after the ring's state has changed. The fence pairs with
+// the one in `ring_wait`, so either the waiter sees the change or it is seen here.
+static void ring_notify(_Atomic uint32_t* word, _Atomic uint32_t* waiters) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(waiters, memory_order_relaxed) == 0)
+        return;
+    atomic_fetch_add_explicit(word, 1, memory_order_release);
+    futex_wake_all(word);
+}
+
+static bool ring_can_push(Ring* ring) {
+    uint64_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t seq = atomic_load_explicit(&ring->slots[pos & ring->mask].sequence, memory_order_acquire);
+    return (int64_t)(seq - pos) >= 0;
+}
+
+static bool ring_can_pop(Ring* ring) {
+    uint64_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t seq = atomic_load_explicit(&ring->slots[pos & ring->mask].sequence, memory_order_acquire);
+    return (int64_t)(seq - (pos + 1)) >= 0;
+}
+
+static void ring_wait(Ring* ring, _Atomic uint32_t* word, _Atomic uint32_t* waiters, bool (*ready)(Ring*)) {
+    // Waits are usually short, so spinning first saves on system calls
+    for (int i = 0; i < SPIN_COUNT; i++) {
+        if (ready(ring) || atomic_load_explicit(&ring->closed, memory_order_relaxed))
+            return;
+        cpu_relax();
+    }
+
+    uint32_t seen = atomic_load_explicit(word, memory_order_acquire);
+    atomic_fetch_add_explicit(waiters, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!ready(ring) && !atomic_load_explicit(&ring->closed, memory_order_acquire))
+        futex_wait(word, seen);
+    atomic_fetch_sub_explicit(waiters, 1, memory_order_relaxed);
+}
+
+// The MSVC runtime has no aligned_alloc, and its aligned blocks need their own free
+static Ring* ring_alloc(void) {
+#ifdef __linux__
+    return aligned_alloc(RING_CACHE_LINE, sizeof(Ring));
+#elifdef _WIN32
+    return _aligned_malloc(sizeof(Ring), RING_CACHE_LINE);
+#endif
+}
+
+static void ring_dealloc(Ring* ring) {
+#ifdef __linux__
+    free(ring);
+#elifdef _WIN32
+    _aligned_free(ring);
+#endif
+}
+
+Ring* ring_create(int capacity, RingMode mode) {
+    if (capacity <= 0 || capacity > MAX_CAPACITY)
+        return NULL;
+    uint64_t cap = 1;
+    while (cap < (uint64_t)capacity)
+        cap <<= 1;
+
+    Ring* ring = ring_alloc();
+    if (ring == NULL)
+        return NULL;
+    memset(ring, 0, sizeof(Ring));
+    ring->slots = malloc(cap * sizeof(RingSlot));
+    if (ring->slots == NULL) {
+        ring_dealloc(ring);
+        return NULL;
+    }
+
+    for (uint64_t i = 0; i < cap; i++)
+        atomic_init(&ring->slots[i].sequence, i);
+    ring->mask = cap - 1;
+    ring->mode = mode;
+    return ring;
+}
+
+void ring_free(Ring* ring) {
+    free(ring->slots);
+    ring_dealloc(ring);
+}
+
+// The only producer claims a slot by moving the tail, and publishes it with its sequence
+static bool ring_push_single(Ring* ring, str value) {
+    uint64_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    RingSlot* slot = &ring->slots[pos & ring->mask];
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != pos)
+        return false;
+    slot->value = value;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    // Consumers of SPMC rings bound batches by the tail, so it's stored after the sequence
+    atomic_store_explicit(&ring->tail, pos + 1, memory_order_release);
+    return true;
+}
+
+// Producers race to claim a slot by moving the tail past it
+static bool ring_push_multi(Ring* ring, str value) {
+    uint64_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    RingSlot* slot;
+    while (true) {
+        slot = &ring->slots[pos & ring->mask];
+        uint64_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return false;
+        else
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    }
+    slot->value = value;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+bool ring_try_push(Ring* ring, str value) {
+    if (atomic_load_explicit(&ring->closed, memory_order_relaxed))
+        return false;
+    bool pushed = ring->mode == RingMpsc ? ring_push_multi(ring, value) : ring_push_single(ring, value);
+    if (pushed)
+        ring_notify(&ring->not_empty, &ring->empty_waiters);
+    return pushed;
+}
+
+int ring_try_push_n(Ring* ring, str* values, int count) {
+    if (count <= 0 || atomic_load_explicit(&ring->closed, memory_order_relaxed))
+        return 0;
+
+    uint64_t capacity = ring->mask + 1;
+    uint64_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t n = 0;
+    if (ring->mode == RingMpsc) {
+        // The only consumer releases slots in order before moving the head, so every slot
+        // below `head + capacity` is free
+        do {
+            uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+            uint64_t free_slots = head + capacity - pos;
+            n = free_slots < (uint64_t)count ? free_slots : (uint64_t)count;
+            if (n == 0 || (int64_t)free_slots < 0)
+                return 0;
+        } while (!atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + n, memory_order_relaxed,
+                                                        memory_order_relaxed));
+    }
+    else {
+        // Consumers of SPMC rings can release slots out of order, so each one is checked
+        while (n < (uint64_t)count
+               && atomic_load_explicit(&ring->slots[(pos + n) & ring->mask].sequence, memory_order_acquire)
+                      == pos + n)
+            n++;
+        if (n == 0)
+            return 0;
+    }
+
+    for (uint64_t i = 0; i < n; i++) {
+        RingSlot* slot = &ring->slots[(pos + i) & ring->mask];
+        slot->value = values[i];
+        atomic_store_explicit(&slot->sequence, pos + i + 1, memory_order_release);
+    }
+    if (ring->mode != RingMpsc)
+        atomic_store_explicit(&ring->tail, pos + n, memory_order_release);
+    ring_notify(&ring->not_empty, &ring->empty_waiters);
+    return n;
+}
+
+// The only consumer releases a slot for the next lap, then moves the head past it
+static bool ring_pop_single(Ring* ring, str* value) {
+    uint64_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    RingSlot* slot = &ring->slots[pos & ring->mask];
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != pos + 1)
+        return false;
+    *value = slot->value;
+    atomic_store_explicit(&slot->sequence, pos + ring->mask + 1, memory_order_release);
+    // Producers of MPSC rings bound batches by the head, so it's stored after the sequence
+    atomic_store_explicit(&ring->head, pos + 1, memory_order_release);
+    return true;
+}
+
+// Consumers race to claim a slot by moving the head past it
+static bool ring_pop_multi(Ring* ring, str* value) {
+    uint64_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    RingSlot* slot;
+    while (true) {
+        slot = &ring->slots[pos & ring->mask];
+        uint64_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int64_t diff = (int64_t)(seq - (pos + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return false;
+        else
+            pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    }
+    *value = slot->value;
+    atomic_store_explicit(&slot->sequence, pos + ring->mask + 1, memory_order_release);
+    return true;
+}
+
+bool ring_try_pop(Ring* ring, str* value) {
+    bool popped = ring->mode == RingSpmc ? ring_pop_multi(ring, value) : ring_pop_single(ring, value);
+    if (popped)
+        ring_notify(&ring->not_full, &ring->full_waiters);
+    return popped;
+}
+
+int ring_try_pop_n(Ring* ring, str* values, int max_count) {
+    if (max_count <= 0)
+        return 0;
+
+    uint64_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t n = 0;
+    if (ring->mode == RingSpmc) {
+        // The only producer publishes slots in order before moving the tail, so every slot
+        // below the tail is ready
+        do {
+            uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+            uint64_t ready_slots = tail - pos;
+            n = ready_slots < (uint64_t)max_count ? ready_slots : (uint64_t)max_count;
+            if (n == 0 || (int64_t)ready_slots < 0)
+                return 0;
+        } while (!atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + n, memory_order_relaxed,
+                                                        memory_order_relaxed));
+    }
+    else {
+        // Producers of MPSC rings can publish slots out of order, so each one is checked
+        while (n < (uint64_t)max_count
+               && atomic_load_explicit(&ring->slots[(pos + n) & ring->mask].sequence, memory_order_acquire)
+                      == pos + n + 1)
+            n++;
+        if (n == 0)
+            return 0;
+    }
+
+    for (uint64_t i = 0; i < n; i++) {
+        RingSlot* slot = &ring->slots[(pos + i) & ring->mask];
+        values[i] = slot->value;
+        atomic_store_explicit(&slot->sequence, pos + i + ring->mask + 1, memory_order_release);
+    }
+    if (ring->mode != RingSpmc)
+        atomic_store_explicit(&ring->head, pos + n, memory_order_release);
+    ring_notify(&ring->not_full, &ring->full_waiters);
+    return n;
+}
+
+bool ring_push(Ring* ring, str value) {
+    while (!ring_try_push(ring, value)) {
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire))
+            return false;
+        ring_wait(ring, &ring->not_full, &ring->full_waiters, ring_can_push);
+    }
+    return true;
+}
+
+int ring_push_n(Ring* ring, str* values, int count) {
+    int total = 0;
+    while (total < count) {
+        int pushed = ring_try_push_n(ring, values + total, count - total);
+        total += pushed;
+        if (pushed == 0) {
+            if (atomic_load_explicit(&ring->closed, memory_order_acquire))
+                break;
+            ring_wait(ring, &ring->not_full, &ring->full_waiters, ring_can_push);
+        }
+    }
+    return total;
+}
+
+bool ring_pop(Ring* ring, str* value) {
+    while (!ring_try_pop(ring, value)) {
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            // Pushes that started before the ring was closed may have just finished
+            return ring_try_pop(ring, value);
+        }
+        ring_wait(ring, &ring->not_empty, &ring->empty_waiters, ring_can_pop);
+    }
+    return true;
+}
+
+int ring_pop_n(Ring* ring, str* values, int max_count) {
+    if (max_count <= 0)
+        return 0;
+    int popped;
+    while ((popped = ring_try_pop_n(ring, values, max_count)) == 0) {
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire))
+            return ring_try_pop_n(ring, values, max_count);
+        ring_wait(ring, &ring->not_empty, &ring->empty_waiters, ring_can_pop);
+    }
+    return popped;
+}
+
+void ring_close(Ring* ring) {
+    atomic_store_explicit(&ring->closed, true, memory_order_release);
+    atomic_fetch_add_explicit(&ring->not_empty, 1, memory_order_release);
+    atomic_fetch_add_explicit(&ring->not_full, 1, memory_order_release);
+    futex_wake_all(&ring->not_empty);
+    futex_wake_all(&ring->not_full);
+}
@@ -0,0 +1,555 @@
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#ifdef __linux__
+#include <unistd.h>
+#elifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <windows.h>
+#endif
+
+#include "sort.h"
+#include "file.h"
+#include "hash.h"
+#include "str.h"
+#include "vec.h"
+
+#define DEFAULT_MEMORY_BUDGET (256LL * 1024 * 1024)
+#define MIN_MEMORY_BUDGET     (64 * 1024)
+// Most runs merged at once; more runs than this are merged in several passes
+#define MAX_MERGE_WIDTH       64
+#define MIN_READ_BUF_SIZE     4096
+#define WRITE_BUF_SIZE        (256 * 1024)
+#define TEMP_FILE_NAME        "/fiesta_sort_XXXXXX"
+// Runs of records shorter than this are insertion sorted
+#define INSERTION_SORT_LEN    16
+
+typedef struct {
+    char* line;
+    //\ The key's first 8 bytes, big-endian, so that most
+    //\ comparisons are a single integer comparison.
+    uint64_t prefix;
+    uint32_t len;
+    uint32_t key_offset;
+    uint32_t key_len;
+} SortRecord;
+
+DEFINE_VEC(File)
+
+typedef struct {
+    File* file;
+    Vec(char) buf;
+    //\ The last key written, for unique mode.
+    Vec(char) last_key;
+    bool has_last_key;
+    bool unique;
+    bool ok;
+} LineWriter;
+
+typedef struct {
+    SortOptions* options;
+    //\ The chunk's buffer, which is kept once the task has
+    //\ finished to be reused for reading the next chunk.
+    char* chunk;
+    size_t cap;
+    size_t len;
+    size_t num_lines;
+    File run;
+    bool ok;
+    //\ Set until the task's run has been collected, and
+    //\ while the task is running on its own thread.
+    bool started;
+    bool running;
+    pthread_t thread;
+} RunTask;
+
+typedef struct {
+    File* file;
+    char* buf;
+    size_t cap;
+    size_t start;
+    size_t len;
+    bool eof;
+    bool ok;
+    SortRecord current;
+} RunReader;
+
+static void find_key(SortRecord* record, SortOptions* options) {
+    record->key_offset = 0;
+    record->key_len = record->len;
+    if (options->key_field > 0) {
+        char* start = record->line;
+        char* end = record->line + record->len;
+        for (int field = 1; field < options->key_field && start != NULL; field++) {
+            char* delimiter = memchr(start, options->key_delimiter, end - start);
+            start = delimiter != NULL ? delimiter + 1 : NULL;
+        }
+        if (start == NULL) {
+            record->key_offset = record->len;
+            record->key_len = 0;
+        }
+        else {
+            char* delimiter = memchr(start, options->key_delimiter, end - start);
+            record->key_offset = start - record->line;
+            record->key_len = (delimiter != NULL ? delimiter : end) - start;
+        }
+    }
+
+    uint64_t prefix = 0;
+    char* key = record->line + record->key_offset;
+    for (uint32_t i = 0; i < 8; i++)
+        prefix = (prefix << 8) | (i < record->key_len ? (uint8_t)key[i] : 0);
+    record->prefix = prefix;
+}
+
+static int compare_bytes(char* a, size_t a_len, char* b, size_t b_len) {
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (cmp != 0)
+        return cmp;
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+static int compare_records(SortRecord* a, SortRecord* b) {
+    if (a->prefix != b->prefix)
+        return a->prefix < b->prefix ? -1 : 1;
+    int cmp = compare_bytes(a->line + a->key_offset, a->key_len, b->line + b->key_offset, b->key_len);
+    if (cmp != 0)
+        return cmp;
+    // Equal keys are ordered by the whole line, so the output doesn't depend on the runs
+    return compare_bytes(a->line, a->len, b->line, b->len);
+}
+
+/* Merge sort `records`, using `scratch` (with room for `len / 2` records) rather than
+allocating, so that sorting a chunk stays within its budget. */
+static void sort_records(SortRecord* records, SortRecord* scratch, size_t len) {
+    if (len < INSERTION_SORT_LEN) {
+        for (size_t i = 1; i < len; i++) {
+            SortRecord record = records[i];
+            size_t j = i;
+            for (; j > 0 && compare_records(&record, &records[j - 1]) < 0; j--)
+                records[j] = records[j - 1];
+            records[j] = record;
+        }
+        return;
+    }
+
+    size_t half = len / 2;
+    sort_records(records, scratch, half);
+    sort_records(records + half, scratch, len - half);
+    if (compare_records(&records[half - 1], &records[half]) <= 0)
+        return;
+    // Only the first half needs moving out of the way, since the merge never overtakes the second
+    memcpy(scratch, records, half * sizeof(SortRecord));
+    size_t i = 0;
+    size_t j = half;
+    size_t k = 0;
+    while (i < half && j < len)
+        records[k++] = compare_records(&records[j], &scratch[i]) < 0 ? records[j++] : scratch[i++];
+    memcpy(records + k, scratch + i, (half - i) * sizeof(SortRecord));
+}
+
+// A chunk's records (and the scratch space for sorting them) follow its lines in the same buffer.
+static size_t chunk_records_offset(size_t text_len) {
+    return (text_len + _Alignof(SortRecord) - 1) / _Alignof(SortRecord) * _Alignof(SortRecord);
+}
+
+static size_t chunk_size(size_t text_len, size_t num_lines) {
+    return chunk_records_offset(text_len) + (num_lines + num_lines / 2) * sizeof(SortRecord);
+}
+
+static bool open_temp_file(File* file, SortOptions* options) {
+#ifdef __linux__
+    dynstr path = dynstr_create();
+    bool ok;
+    if (options->temp_dir.len > 0)
+        ok = dynstr_append_str(&path, options->temp_dir);
+    else {
+        char* temp_dir = getenv("TMPDIR");
+        ok = dynstr_append(&path, temp_dir != NULL && temp_dir[0] != '\0' ? temp_dir : "/tmp");
+    }
+    ok = ok && dynstr_append(&path, TEMP_FILE_NAME);
+
+    int fd = ok ? mkstemp(path.data) : -1;
+    if (fd < 0) {
+        dynstr_free(path);
+        return false;
+    }
+    // Only the descriptor refers to it now, so it's removed even if sorting is interrupted
+    unlink(path.data);
+    dynstr_free(path);
+    FILE* ptr = fdopen(fd, "w+b");
+    if (ptr == NULL) {
+        close(fd);
+        return false;
+    }
+    *file = (File){.ptr = ptr, .position = 0, .access_modes = FileRead | FileWrite | FileBinary, .direct_fd = -1};
+    return true;
+#elifdef _WIN32
+    char dir[MAX_PATH + 1];
+    if (options->temp_dir.len > 0) {
+        if (options->temp_dir.len > MAX_PATH)
+            return false;
+        memcpy(dir, options->temp_dir.data, options->temp_dir.len);
+        dir[options->temp_dir.len] = '\0';
+    }
+    else if (GetTempPathA(sizeof(dir), dir) == 0)
+        return false;
+    char path[MAX_PATH + 1];
+    if (GetTempFileNameA(dir, "fst", 0, path) == 0)
+        return false;
+
+    // The name is only reserved, so it's reopened to be removed when the handle is closed
+    HANDLE handle = CreateFileA(
+        path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL
+    );
+    if (handle == INVALID_HANDLE_VALUE) {
+        DeleteFileA(path);
+        return false;
+    }
+    int fd = _open_osfhandle((intptr_t)handle, _O_RDWR | _O_BINARY);
+    if (fd < 0) {
+        CloseHandle(handle);
+        return false;
+    }
+    FILE* ptr = _fdopen(fd, "w+b");
+    if (ptr == NULL) {
+        _close(fd);
+        return false;
+    }
+    *file = (File){.ptr = ptr, .position = 0, .access_modes = FileRead | FileWrite | FileBinary, .direct_fd = -1};
+    return true;
+#endif
+}
+
+static LineWriter line_writer_create(File* file, bool unique) {
+    return (LineWriter){.file = file, .unique = unique, .ok = true};
+}
+
+static void line_writer_flush(LineWriter* writer) {
+    if (writer->buf.len > 0 && writer->ok) {
+        str data = {.data = writer->buf.data, .len = writer->buf.len};
+        writer->ok = file_write_str(writer->file, data) == (size_t)data.len;
+    }
+    vec_char_clear(&writer->buf);
+}
+
+static void line_writer_write(LineWriter* writer, SortRecord* record) {
+    if (writer->unique) {
+        char* key = record->line + record->key_offset;
+        if (writer->has_last_key
+            && compare_bytes(writer->last_key.data, writer->last_key.len, key, record->key_len) == 0)
+            return;
+        vec_char_clear(&writer->last_key);
+        vec_char_push_n(&writer->last_key, key, record->key_len);
+        writer->has_last_key = true;
+    }
+
+    vec_char_push_n(&writer->buf, record->line, record->len);
+    vec_char_push(&writer->buf, '\n');
+    if (writer->buf.len >= WRITE_BUF_SIZE)
+        line_writer_flush(writer);
+}
+
+static bool line_writer_finish(LineWriter* writer) {
+    line_writer_flush(writer);
+    vec_char_free(writer->buf);
+    vec_char_free(writer->last_key);
+    return writer->ok;
+}
+
+// Sort a chunk of lines and write them to a new run file.
+static void* sort_run(void* arg) {
+    RunTask* task = arg;
+    SortRecord* records = (SortRecord*)(task->chunk + chunk_records_offset(task->len));
+    char* start = task->chunk;
+    char* end = task->chunk + task->len;
+    for (size_t i = 0; i < task->num_lines; i++) {
+        char* newline = memchr(start, '\n', end - start);
+        char* line_end = newline != NULL ? newline : end;
+        records[i] = (SortRecord){.line = start, .len = line_end - start};
+        find_key(&records[i], task->options);
+        start = line_end + 1;
+    }
+    sort_records(records, records + task->num_lines, task->num_lines);
+
+    task->ok = open_temp_file(&task->run, task->options);
+    if (task->ok) {
+        LineWriter writer = line_writer_create(&task->run, task->options->unique);
+        for (size_t i = 0; i < task->num_lines; i++)
+            line_writer_write(&writer, &records[i]);
+        task->ok = line_writer_finish(&writer);
+        file_rewind(&task->run);
+    }
+    return NULL;
+}
+
+static bool finish_run_task(RunTask* task, Vec(File)* runs) {
+    if (!task->started)
+        return true;
+    if (task->running)
+        pthread_join(task->thread, NULL);
+    task->started = false;
+    task->running = false;
+    if (task->ok)
+        vec_File_push(runs, task->run);
+    else if (task->run.ptr != NULL)
+        file_close(&task->run);
+    return task->ok;
+}
+
+static void start_run_task(RunTask* task) {
+    task->run = (File){0};
+    task->started = true;
+    task->running = pthread_create(&task->thread, NULL, sort_run, task) == 0;
+    if (!task->running)
+        sort_run(task);
+}
+
+// Read `input` in chunks of at most `chunk_budget` bytes (including their records and sorting
+// scratch space), and sort each chunk into a run file on one of `num_threads` threads.
+static bool make_runs(File* input, SortOptions* options, size_t chunk_budget, int num_threads, Vec(File)* runs) {
+    RunTask* tasks = calloc(num_threads, sizeof(RunTask));
+    if (tasks == NULL)
+        return false;
+
+    size_t cap = chunk_budget;
+    size_t len = 0;
+    char* buf = malloc(cap);
+    bool ok = buf != NULL;
+    bool eof = false;
+    int next_task = 0;
+    while (ok && !(eof && len == 0)) {
+        if (!eof && len < cap) {
+            size_t bytes_read = fread(buf + len, sizeof(char), cap - len, input->ptr);
+            if (input->hasher != NULL)
+                hasher_update(input->hasher, buf + len, bytes_read);
+            len += bytes_read;
+            if (len < cap) {
+                eof = true;
+                ok = !ferror(input->ptr);
+            }
+        }
+
+        // Take as many whole lines as fit in the budget
+        size_t chunk_len = 0;
+        size_t num_lines = 0;
+        while (chunk_len < len) {
+            char* newline = memchr(buf + chunk_len, '\n', len - chunk_len);
+            // The input's last line might not end with a newline
+            if (newline == NULL && !eof)
+                break;
+            size_t line_end = newline != NULL ? (size_t)(newline - buf) + 1 : len;
+            if (num_lines > 0 && chunk_size(line_end, num_lines + 1) > chunk_budget)
+                break;
+            chunk_len = line_end;
+            num_lines++;
+        }
+        if (num_lines == 0) {
+            if (len == 0)
+                break;
+            // A single line is longer than the buffer, so it grows to fit
+            char* new_buf = cap < UINT32_MAX ? realloc(buf, cap * 2) : NULL;
+            ok = new_buf != NULL;
+            buf = new_buf != NULL ? new_buf : buf;
+            cap *= 2;
+            continue;
+        }
+
+        /* The chunk goes to a thread, and the rest of the buffer moves to the buffer that thread
+        last sorted. Buffers are reused rather than freed, since the allocator would otherwise
+        tend to keep the freed ones around as well as the new ones. */
+        RunTask* task = &tasks[next_task];
+        next_task = (next_task + 1) % num_threads;
+        ok = finish_run_task(task, runs);
+        size_t rest_len = len - chunk_len;
+        size_t next_cap = chunk_budget > rest_len ? chunk_budget : rest_len;
+        char* next_buf = task->chunk;
+        if (ok && task->cap != next_cap)
+            next_buf = realloc(task->chunk, next_cap);
+        if (!ok || next_buf == NULL) {
+            ok = false;
+            break;
+        }
+        task->chunk = NULL;
+        memcpy(next_buf, buf + chunk_len, rest_len);
+        // Only a chunk holding a single line longer than the budget lacks room for its records
+        if (chunk_size(chunk_len, num_lines) > cap) {
+            char* new_buf = realloc(buf, chunk_size(chunk_len, num_lines));
+            if (new_buf == NULL) {
+                free(next_buf);
+                ok = false;
+                break;
+            }
+            buf = new_buf;
+            cap = chunk_size(chunk_len, num_lines);
+        }
+        *task = (RunTask){.options = options, .chunk = buf, .cap = cap, .len = chunk_len, .num_lines = num_lines};
+        start_run_task(task);
+        len = rest_len;
+        cap = next_cap;
+        buf = next_buf;
+    }
+    free(buf);
+
+    for (int i = 0; i < num_threads; i++) {
+        ok = finish_run_task(&tasks[i], runs) && ok;
+        free(tasks[i].chunk);
+    }
+    free(tasks);
+    input->position = file_get_position(*input);
+    return ok;
+}
+
+// Move a run reader to its next line, returning false at the end of its run.
+static bool run_reader_next(RunReader* reader, SortOptions* options) {
+    while (true) {
+        char* newline = memchr(reader->buf + reader->start, '\n', reader->len - reader->start);
+        if (newline != NULL) {
+            char* line = reader->buf + reader->start;
+            reader->current = (SortRecord){.line = line, .len = newline - line};
+            find_key(&reader->current, options);
+            reader->start = newline - reader->buf + 1;
+            return true;
+        }
+        // Run files always end with a newline
+        if (reader->eof)
+            return false;
+
+        memmove(reader->buf, reader->buf + reader->start, reader->len - reader->start);
+        reader->len -= reader->start;
+        reader->start = 0;
+        if (reader->len == reader->cap) {
+            char* new_buf = realloc(reader->buf, reader->cap * 2);
+            if (new_buf == NULL) {
+                reader->ok = false;
+                return false;
+            }
+            reader->buf = new_buf;
+            reader->cap *= 2;
+        }
+        size_t bytes_read = fread(reader->buf + reader->len, sizeof(char), reader->cap - reader->len, reader->file->ptr);
+        reader->len += bytes_read;
+        if (bytes_read == 0) {
+            reader->eof = true;
+            reader->ok = !ferror(reader->file->ptr);
+        }
+    }
+}
+
+static void heap_sift_down(RunReader** heap, int len, int index) {
+    while (true) {
+        int smallest = index;
+        int left = index * 2 + 1;
+        int right = left + 1;
+        if (left < len && compare_records(&heap[left]->current, &heap[smallest]->current) < 0)
+            smallest = left;
+        if (right < len && compare_records(&heap[right]->current, &heap[smallest]->current) < 0)
+            smallest = right;
+        if (smallest == index)
+            return;
+        RunReader* tmp = heap[index];
+        heap[index] = heap[smallest];
+        heap[smallest] = tmp;
+        index = smallest;
+    }
+}
+
+// Merge sorted runs into `writer`, closing them afterwards.
+static bool merge_runs(File* runs, int num_runs, LineWriter* writer, SortOptions* options, size_t buf_size) {
+    RunReader* readers = calloc(num_runs, sizeof(RunReader));
+    RunReader** heap = malloc(num_runs * sizeof(RunReader*));
+    bool ok = readers != NULL && heap != NULL;
+    int heap_len = 0;
+    for (int i = 0; ok && i < num_runs; i++) {
+        readers[i] = (RunReader){.file = &runs[i], .buf = malloc(buf_size), .cap = buf_size, .ok = true};
+        ok = readers[i].buf != NULL;
+        if (ok && run_reader_next(&readers[i], options))
+            heap[heap_len++] = &readers[i];
+        ok = ok && readers[i].ok;
+    }
+    for (int i = heap_len / 2 - 1; i >= 0; i--)
+        heap_sift_down(heap, heap_len, i);
+
+    while (ok && heap_len > 0) {
+        RunReader* reader = heap[0];
+        line_writer_write(writer, &reader->current);
+        if (!run_reader_next(reader, options)) {
+            ok = reader->ok;
+            heap[0] = heap[--heap_len];
+        }
+        heap_sift_down(heap, heap_len, 0);
+    }
+
+    for (int i = 0; readers != NULL && i < num_runs; i++)
+        free(readers[i].buf);
+    for (int i = 0; i < num_runs; i++)
+        file_close(&runs[i]);
+    free(heap);
+    free(readers);
+    return ok;
+}
+
+bool sort_lines(File* input, File* output, SortOptions options) {
+    int64_t budget = options.memory_budget > 0 ? options.memory_budget : DEFAULT_MEMORY_BUDGET;
+    if (budget < MIN_MEMORY_BUDGET)
+        budget = MIN_MEMORY_BUDGET;
+    int num_threads = options.num_threads;
+#ifdef __linux__
+    if (num_threads <= 0)
+        num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (num_threads <= 0)
+        num_threads = 1;
+
+    // Each thread's chunk and the chunk being read share the budget
+    Vec(File) runs = vec_File_create();
+    bool ok = make_runs(input, &options, budget / (num_threads + 1), num_threads, &runs);
+
+    // Too many runs to merge at once are merged in groups, until few enough are left
+    size_t buf_size = budget / (MAX_MERGE_WIDTH + 1);
+    if (buf_size < MIN_READ_BUF_SIZE)
+        buf_size = MIN_READ_BUF_SIZE;
+    while (ok && runs.len > MAX_MERGE_WIDTH) {
+        Vec(File) merged_runs = vec_File_create();
+        int group_start = 0;
+        for (; ok && group_start < runs.len; group_start += MAX_MERGE_WIDTH) {
+            int group_len = runs.len - group_start < MAX_MERGE_WIDTH ? runs.len - group_start : MAX_MERGE_WIDTH;
+            File merged = {0};
+            ok = open_temp_file(&merged, &options);
+            if (!ok)
+                break;
+            LineWriter writer = line_writer_create(&merged, options.unique);
+            ok = merge_runs(runs.data + group_start, group_len, &writer, &options, buf_size);
+            ok = line_writer_finish(&writer) && ok;
+            file_rewind(&merged);
+            vec_File_push(&merged_runs, merged);
+        }
+        // Runs that weren't merged because of an error are closed below
+        for (int i = group_start; i < runs.len; i++)
+            vec_File_push(&merged_runs, runs.data[i]);
+        vec_File_free(runs);
+        runs = merged_runs;
+    }
+
+    if (ok) {
+        LineWriter writer = line_writer_create(output, options.unique);
+        ok = merge_runs(runs.data, runs.len, &writer, &options, buf_size);
+        ok = line_writer_finish(&writer) && ok;
+    }
+    else {
+        for (int i = 0; i < runs.len; i++)
+            file_close(&runs.data[i]);
+    }
+    vec_File_free(runs);
+    return ok;
+}
@@ -1,51 +1,26 @@
 #ifndef _WIN32
 #include <sys/param.h>
 #endif
+#include <ctype.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STR_X86_SIMD
+#endif
 
 #include "str.h"
 
 #define DYN_BASE_SIZE     10
-#define DYN_GROWTH_RATE 1.5f
 #define NULL_STR   STR("\0")
-
-typedef struct {
-    void* data;
-    int len;
-    int cap;
-} dynobj;
-
-static void maybe_realloc(dynobj* obj, int num_new_elements, int element_size) {
-    // Allocate more memory if needed
-    if (obj->len + num_new_elements >= obj->cap) {
-        obj->cap += num_new_elements;
-        obj->cap *= DYN_GROWTH_RATE;
-        void* new_ptr = realloc(obj->data, obj->cap * element_size);
-        if (new_ptr) obj->data = new_ptr;
-        memset(new_ptr + obj->len + num_new_elements, 0, num_new_elements * element_size);
-    }
-    // Reduce memory if over-allocated
-    else if (num_new_elements < 0 && num_new_elements != -obj->len) {
-        obj->cap -= num_new_elements;
-        void* new_ptr = realloc(obj->data, obj->cap * element_size);
-        if (new_ptr) obj->data = new_ptr;
-        memset(new_ptr + obj->len + num_new_elements, 0, num_new_elements * element_size);
-    }
-    /* But don't free the dynobj if clearing all of its elements
-    (passing 0 to realloc would free the allocation) */
-    else if (num_new_elements == -obj->len) {
-        obj->cap = DYN_BASE_SIZE;
-        void* new_ptr = realloc(obj->data, obj->cap * element_size);
-        if (new_ptr) obj->data = new_ptr;
-        memset(new_ptr, 0, obj->cap * element_size);
-    }
-}
+// Room past the end of decoded output for vector stores of whole registers
+#define ENCODING_SLACK    32
+#define INVALID_DIGIT     -1
 
 double stod(str s) {
     return strtod(s.data, NULL);
@@ -104,25 +79,23 @@ void str_println(str string) {
 }
 
 dynstr dynstr_create(void) {
-    dynstr new_str = {0};
+    dynstr new_str = vec_char_create();
 
-    new_str.data = calloc(DYN_BASE_SIZE, sizeof(char));
-    new_str.len = 0;
-    new_str.cap = DYN_BASE_SIZE;
-    new_str.data[new_str.len + 1] = '\0';
+    if (vec_char_reserve(&new_str, DYN_BASE_SIZE))
+        new_str.data[0] = '\0';
 
     return new_str;
 }
 
 dynstr dynstr_create_from(char* text) {
-    dynstr new_str = {0};
-
-    new_str.len = strlen(text);
-    /* If `text` is shorter than `DYN_BASE_SIZE`,
-    use `DYN_BASE_SIZE` for the cap */
-    new_str.cap = fmax(new_str.len, DYN_BASE_SIZE) * DYN_GROWTH_RATE;
-    new_str.data = calloc(new_str.cap, sizeof(char));
-    memcpy(new_str.data, text, new_str.len);
+    dynstr new_str = vec_char_create();
+
+    int text_len = strlen(text);
+    // Make room for the null terminator as well
+    if (!vec_char_reserve(&new_str, text_len + 1))
+        return new_str;
+    memcpy(new_str.data, text, text_len);
+    new_str.len = text_len;
     new_str.data[new_str.len] = '\0';
 
     return new_str;
@@ -132,26 +105,28 @@ void dynstr_free(dynstr string) {
     free(string.data);
 }
 
-void dynstr_append(dynstr* string, char* text) {
-    int text_len = strlen(text);
-    maybe_realloc((dynobj*)string, text_len, sizeof(char));
-
-    memcpy(&string->data[string->len], text, text_len);
-    string->len += text_len;
+bool dynstr_append(dynstr* string, char* text) {
+    return dynstr_append_str(string, str_create_from(text));
 }
 
-void dynstr_append_str(dynstr* string, str text) {
-    maybe_realloc((dynobj*)string, text.len, sizeof(char));
+bool dynstr_append_str(dynstr* string, str text) {
+    if (text.len < 0 || text.len == INT_MAX || !vec_char_reserve(string, text.len + 1))
+        return false;
+
     memcpy(&string->data[string->len], text.data, text.len);
     string->len += text.len;
+    string->data[string->len] = '\0';
+    return true;
 }
 
-void dynstr_append_char(dynstr* string, char c) {
-    maybe_realloc((dynobj*)string, 1, sizeof(char));
+bool dynstr_append_char(dynstr* string, char c) {
+    if (!vec_char_reserve(string, 2))
+        return false;
 
     string->data[string->len] = c;
     string->len++;
     string->data[string->len] = '\0';
+    return true;
 }
 
 // [start, end)
@@ -169,13 +144,13 @@ void dynstr_remove(dynstr* string, int start, int end) {
     }
     string->len -= num_removed;
     string->data[string->len] = '\0';
-    // TODO: heuristic for reducing allocation size
-    // maybe_realloc((dynobj*)string, -(end - start), sizeof(char));
 }
 
 void dynstr_clear(dynstr* string) {
-    maybe_realloc((dynobj*)string, -string->len, sizeof(char));
+    // Keep the allocation around for reuse
     string->len = 0;
+    if (string->data != NULL)
+        string->data[0] = '\0';
 }
 
 int dynstr_compare(dynstr a, dynstr b) {
@@ -214,36 +189,28 @@ str dynstr_to_str(dynstr src) {
 }
 
 str_arr str_arr_create(void) {
-    str_arr new_arr;
+    str_arr new_arr = vec_str_create();
 
-    new_arr.cap = DYN_BASE_SIZE;
-    new_arr.len = 0;
-    new_arr.data = malloc(sizeof(str) * new_arr.cap);
+    vec_str_reserve(&new_arr, DYN_BASE_SIZE);
 
     return new_arr;
 }
 
 str_arr str_arr_create_from(str* arr) {
-    str_arr new_arr = {0};
+    str_arr new_arr = vec_str_create();
 
-    // Get array length (`arr` must be null-terminated)    
-    str* ptr = &arr[0];
+    // Get array length (`arr` must be terminated by a str with NULL data)
     int arr_len = 0;
-    while (ptr) {
+    while (arr[arr_len].data != NULL)
         arr_len++;
-        ptr++;
-    }
 
-    new_arr.cap = arr_len * DYN_GROWTH_RATE;
-    new_arr.len = arr_len;
-    new_arr.data = malloc(sizeof(str) * new_arr.cap);
-    memcpy(new_arr.data, arr, sizeof(str) * arr_len);
+    vec_str_push_n(&new_arr, arr, arr_len);
 
     return new_arr;
 }
 
 void str_arr_free(str_arr arr) {
-    free(arr.data);
+    vec_str_free(arr);
 }
 
 void str_arr_free_elements(str_arr arr) {
@@ -259,26 +226,14 @@ str str_arr_get(str_arr arr, int index) {
 }
 
 void str_arr_append(str_arr* arr, str new_str) {
-    maybe_realloc((dynobj*)arr, 1, sizeof(str));
-
-    memcpy(&arr->data[arr->len], &new_str, sizeof(str));
-    arr->len++;
+    vec_str_push(arr, new_str);
 }
 
 str str_arr_remove(str_arr* arr, int index) {
     if (index < 0 || index >= arr->len)
         return NULL_STR;
-    // Remove the str from the array
-    str removed = str_create_from(arr->data[index].data);
-    arr->data[index] = NULL_STR;
     // Move every following item back by one spot
-    for (int i = index; i < arr->len; i++) {
-        arr->data[i] = arr->data[i+1];
-    }
-    arr->len--;
-    maybe_realloc((dynobj*)arr, -1, sizeof(str));
-
-    return removed;
+    return vec_str_remove(arr, index);
 }
 
 void str_arr_print(str_arr arr) {
@@ -303,4 +258,548 @@ str str_arr_to_str(str_arr* arr, str* separator, bool free_elements) {
         str_arr_free(*arr);
 
     return dynstr_to_str(joined);
-}
\ No newline at end of file
+}
+
+str_pack str_pack_create(void) {
+    return (str_pack){
+        .bytes = vec_char_create(),
+        .offsets = vec_uint32_t_create()
+    };
+}
+
+void str_pack_free(str_pack pack) {
+    vec_char_free(pack.bytes);
+    vec_uint32_t_free(pack.offsets);
+}
+
+int str_pack_len(str_pack pack) {
+    return pack.offsets.len;
+}
+
+bool str_pack_reserve(str_pack* pack, int num_strings, int num_bytes) {
+    if (num_strings < 0 || num_bytes < 0 || num_bytes > INT_MAX - num_strings)
+        return false;
+    // Make room for the null terminators as well
+    return vec_uint32_t_reserve(&pack->offsets, num_strings)
+        && vec_char_reserve(&pack->bytes, num_bytes + num_strings);
+}
+
+str str_pack_get(str_pack pack, int index) {
+    if (index >= pack.offsets.len || index < 0)
+        return NULL_STR;
+    uint32_t start = pack.offsets.data[index];
+    uint32_t end = index + 1 < pack.offsets.len ? pack.offsets.data[index + 1] : (uint32_t)pack.bytes.len;
+    // Don't count the null terminator
+    return (str){.data = &pack.bytes.data[start], .len = end - start - 1};
+}
+
+bool str_pack_append(str_pack* pack, str string) {
+    if (string.len < 0 || string.len == INT_MAX || !vec_char_reserve(&pack->bytes, string.len + 1)
+        || !vec_uint32_t_push(&pack->offsets, pack->bytes.len))
+        return false;
+    memcpy(&pack->bytes.data[pack->bytes.len], string.data, string.len);
+    pack->bytes.len += string.len;
+    pack->bytes.data[pack->bytes.len++] = '\0';
+    return true;
+}
+
+void str_pack_clear(str_pack* pack) {
+    vec_char_clear(&pack->bytes);
+    vec_uint32_t_clear(&pack->offsets);
+}
+
+void str_pack_print(str_pack pack) {
+    printf("[");
+    for (int i = 0; i < pack.offsets.len; i++) {
+        printf("\"%s\"", str_pack_get(pack, i).data);
+        if (i != pack.offsets.len - 1) printf(", ");
+    }
+    printf("]\n");
+}
+
+Optional(str_pack) str_pack_from_arr(str_arr arr) {
+    str_pack pack = str_pack_create();
+    int64_t num_bytes = 0;
+    for (int i = 0; i < arr.len; i++)
+        num_bytes += arr.data[i].len;
+    bool ok = num_bytes <= INT_MAX && str_pack_reserve(&pack, arr.len, num_bytes);
+    for (int i = 0; ok && i < arr.len; i++)
+        ok = str_pack_append(&pack, arr.data[i]);
+    if (!ok) {
+        str_pack_free(pack);
+        return None(str_pack);
+    }
+    return Some(str_pack, pack);
+}
+
+Optional(str_arr) str_pack_to_arr(str_pack pack) {
+    str_arr arr = vec_str_create();
+    if (!vec_str_reserve(&arr, pack.offsets.len))
+        return None(str_arr);
+    for (int i = 0; i < pack.offsets.len; i++)
+        arr.data[i] = str_pack_get(pack, i);
+    arr.len = pack.offsets.len;
+    return Some(str_arr, arr);
+}
+
+Optional(str_pack) str_split_packed(str src, char delimiter) {
+    str_pack split_pack = str_pack_create();
+    // Every string's bytes come from `src`, plus a terminator
+    bool ok = src.len >= 0 && src.len < INT_MAX && vec_char_reserve(&split_pack.bytes, src.len + 1);
+    char* start = src.data;
+    char* end = src.data + src.len;
+    while (ok) {
+        char* found = memchr(start, delimiter, end - start);
+        char* split_end = found != NULL ? found : end;
+        ok = str_pack_append(&split_pack, (str){.data = start, .len = split_end - start});
+        if (found == NULL)
+            break;
+        start = found + 1;
+    }
+    if (!ok) {
+        str_pack_free(split_pack);
+        return None(str_pack);
+    }
+    return Some(str_pack, split_pack);
+}
+
+static const char base64_chars[2][65] = {
+    [Base64Standard] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+    [Base64Url]      = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"
+};
+static const char hex_chars[] = "0123456789abcdef";
+// Value of each character, or INVALID_DIGIT
+static int8_t base64_values[2][256];
+static int8_t hex_values[256];
+static pthread_once_t decode_tables_once = PTHREAD_ONCE_INIT;
+
+static void init_decode_tables(void) {
+    memset(base64_values, INVALID_DIGIT, sizeof(base64_values));
+    memset(hex_values, INVALID_DIGIT, sizeof(hex_values));
+    for (int alphabet = 0; alphabet < 2; alphabet++) {
+        for (int i = 0; i < 64; i++)
+            base64_values[alphabet][(uint8_t)base64_chars[alphabet][i]] = i;
+    }
+    for (int i = 0; i < 16; i++) {
+        hex_values[(uint8_t)hex_chars[i]] = i;
+        hex_values[(uint8_t)toupper(hex_chars[i])] = i;
+    }
+}
+
+// Reserve `n` bytes (plus slack and a null terminator) at the end of a dynamic string.
+static char* reserve_output(dynstr* dst, size_t n) {
+    if (n > (size_t)INT_MAX - ENCODING_SLACK - 1 || !vec_char_reserve(dst, n + ENCODING_SLACK + 1))
+        return NULL;
+    return dst->data + dst->len;
+}
+
+#ifdef STR_X86_SIMD
+/* Each kernel handles as much of its input as it can in whole
+vectors and returns how much input it consumed, leaving the rest
+to the scalar code. Decoding kernels also stop at the first vector
+holding an invalid character, so the scalar code reports it. */
+
+__attribute__((target("ssse3")))
+static __m128i base64_encode_chars_ssse3(__m128i in, Base64Alphabet alphabet) {
+    // Spread each 3 bytes over 4, then move each 6-bit index into its own byte
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    __m128i indices = _mm_or_si128(t1, t3);
+    // Map each range of indices to the offset from index to character
+    __m128i ranges = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i is_upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    ranges = _mm_or_si128(ranges, _mm_and_si128(is_upper, _mm_set1_epi8(13)));
+    char ch62 = base64_chars[alphabet][62];
+    char ch63 = base64_chars[alphabet][63];
+    __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                    '0' - 52, '0' - 52, '0' - 52, '0' - 52, ch62 - 62, ch63 - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, ranges), indices);
+}
+
+__attribute__((target("ssse3")))
+static size_t base64_encode_ssse3(uint8_t* src, size_t len, char* dst, Base64Alphabet alphabet) {
+    size_t consumed = 0;
+    // 12 bytes are encoded at a time, but 16 are loaded
+    for (; len - consumed >= 16; consumed += 12, dst += 16) {
+        __m128i in = _mm_loadu_si128((__m128i*)(src + consumed));
+        _mm_storeu_si128((__m128i*)dst, base64_encode_chars_ssse3(in, alphabet));
+    }
+    return consumed;
+}
+
+__attribute__((target("avx2")))
+static size_t base64_encode_avx2(uint8_t* src, size_t len, char* dst, Base64Alphabet alphabet) {
+    char ch62 = base64_chars[alphabet][62];
+    char ch63 = base64_chars[alphabet][63];
+    __m256i spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                       '0' - 52, '0' - 52, '0' - 52, '0' - 52, ch62 - 62, ch63 - 63, 'A', 0, 0,
+                                       'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                       '0' - 52, '0' - 52, '0' - 52, '0' - 52, ch62 - 62, ch63 - 63, 'A', 0, 0);
+    size_t consumed = 0;
+    // 24 bytes are encoded at a time (12 per lane), but 28 are loaded
+    for (; len - consumed >= 28; consumed += 24, dst += 32) {
+        __m128i lo = _mm_loadu_si128((__m128i*)(src + consumed));
+        __m128i hi = _mm_loadu_si128((__m128i*)(src + consumed + 12));
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        in = _mm256_shuffle_epi8(in, spread);
+        __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(t1, t3);
+        __m256i ranges = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        __m256i is_upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        ranges = _mm256_or_si256(ranges, _mm256_and_si256(is_upper, _mm256_set1_epi8(13)));
+        __m256i chars = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, ranges), indices);
+        _mm256_storeu_si256((__m256i*)dst, chars);
+    }
+    return consumed;
+}
+
+// Unsigned `value <= max` for each byte
+#define IN_RANGE_128(value, max) _mm_cmpeq_epi8(_mm_min_epu8(value, _mm_set1_epi8(max)), value)
+#define IN_RANGE_256(value, max) _mm256_cmpeq_epi8(_mm256_min_epu8(value, _mm256_set1_epi8(max)), value)
+
+__attribute__((target("ssse3")))
+static size_t base64_decode_ssse3(uint8_t* src, size_t len, uint8_t* dst, Base64Alphabet alphabet) {
+    __m128i ch62 = _mm_set1_epi8(base64_chars[alphabet][62]);
+    __m128i ch63 = _mm_set1_epi8(base64_chars[alphabet][63]);
+    size_t consumed = 0;
+    // 16 characters are decoded to 12 bytes at a time, but 16 bytes are stored
+    for (; len - consumed >= 16; consumed += 16, dst += 12) {
+        __m128i in = _mm_loadu_si128((__m128i*)(src + consumed));
+        __m128i upper = _mm_sub_epi8(in, _mm_set1_epi8('A'));
+        __m128i lower = _mm_sub_epi8(in, _mm_set1_epi8('a'));
+        __m128i digit = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+        __m128i is_upper = IN_RANGE_128(upper, 25);
+        __m128i is_lower = IN_RANGE_128(lower, 25);
+        __m128i is_digit = IN_RANGE_128(digit, 9);
+        __m128i is_62 = _mm_cmpeq_epi8(in, ch62);
+        __m128i is_63 = _mm_cmpeq_epi8(in, ch63);
+        __m128i valid = _mm_or_si128(_mm_or_si128(is_upper, is_lower), _mm_or_si128(is_digit, _mm_or_si128(is_62, is_63)));
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            break;
+        __m128i values = _mm_or_si128(_mm_and_si128(is_upper, upper), _mm_and_si128(is_lower, _mm_add_epi8(lower, _mm_set1_epi8(26))));
+        values = _mm_or_si128(values, _mm_and_si128(is_digit, _mm_add_epi8(digit, _mm_set1_epi8(52))));
+        values = _mm_or_si128(values, _mm_and_si128(is_62, _mm_set1_epi8(62)));
+        values = _mm_or_si128(values, _mm_and_si128(is_63, _mm_set1_epi8(63)));
+        // Merge pairs of 6-bit values into 12 bits, then pairs of those into 24
+        __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        merged = _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        _mm_storeu_si128((__m128i*)dst, merged);
+    }
+    return consumed;
+}
+
+__attribute__((target("avx2")))
+static size_t base64_decode_avx2(uint8_t* src, size_t len, uint8_t* dst, Base64Alphabet alphabet) {
+    __m256i ch62 = _mm256_set1_epi8(base64_chars[alphabet][62]);
+    __m256i ch63 = _mm256_set1_epi8(base64_chars[alphabet][63]);
+    __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t consumed = 0;
+    // 32 characters are decoded to 24 bytes at a time, but 32 bytes are stored
+    for (; len - consumed >= 32; consumed += 32, dst += 24) {
+        __m256i in = _mm256_loadu_si256((__m256i*)(src + consumed));
+        __m256i upper = _mm256_sub_epi8(in, _mm256_set1_epi8('A'));
+        __m256i lower = _mm256_sub_epi8(in, _mm256_set1_epi8('a'));
+        __m256i digit = _mm256_sub_epi8(in, _mm256_set1_epi8('0'));
+        __m256i is_upper = IN_RANGE_256(upper, 25);
+        __m256i is_lower = IN_RANGE_256(lower, 25);
+        __m256i is_digit = IN_RANGE_256(digit, 9);
+        __m256i is_62 = _mm256_cmpeq_epi8(in, ch62);
+        __m256i is_63 = _mm256_cmpeq_epi8(in, ch63);
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(is_upper, is_lower),
+                                        _mm256_or_si256(is_digit, _mm256_or_si256(is_62, is_63)));
+        if (_mm256_movemask_epi8(valid) != -1)
+            break;
+        __m256i values = _mm256_or_si256(_mm256_and_si256(is_upper, upper),
+                                         _mm256_and_si256(is_lower, _mm256_add_epi8(lower, _mm256_set1_epi8(26))));
+        values = _mm256_or_si256(values, _mm256_and_si256(is_digit, _mm256_add_epi8(digit, _mm256_set1_epi8(52))));
+        values = _mm256_or_si256(values, _mm256_and_si256(is_62, _mm256_set1_epi8(62)));
+        values = _mm256_or_si256(values, _mm256_and_si256(is_63, _mm256_set1_epi8(63)));
+        __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack);
+        // Close the gap between the lanes' 12 bytes
+        merged = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        _mm256_storeu_si256((__m256i*)dst, merged);
+    }
+    return consumed;
+}
+
+__attribute__((target("ssse3")))
+static size_t hex_encode_ssse3(uint8_t* src, size_t len, char* dst) {
+    __m128i digits = _mm_loadu_si128((__m128i*)hex_chars);
+    __m128i low_nibble = _mm_set1_epi8(0x0F);
+    size_t consumed = 0;
+    for (; len - consumed >= 16; consumed += 16, dst += 32) {
+        __m128i in = _mm_loadu_si128((__m128i*)(src + consumed));
+        __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(in, 4), low_nibble));
+        __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(in, low_nibble));
+        _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return consumed;
+}
+
+__attribute__((target("avx2")))
+static size_t hex_encode_avx2(uint8_t* src, size_t len, char* dst) {
+    __m256i digits = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i*)hex_chars));
+    __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    size_t consumed = 0;
+    for (; len - consumed >= 32; consumed += 32, dst += 64) {
+        __m256i in = _mm256_loadu_si256((__m256i*)(src + consumed));
+        __m256i hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(in, 4), low_nibble));
+        __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(in, low_nibble));
+        // Unpacking works within lanes, so the halves are put back in order
+        __m256i first = _mm256_unpacklo_epi8(hi, lo);
+        __m256i second = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i*)dst, _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    return consumed;
+}
+
+// Convert 16 hex characters to their values, or return false if any aren't hex digits
+__attribute__((target("ssse3")))
+static bool hex_values_ssse3(__m128i in, __m128i* values) {
+    __m128i digit = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(in, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_digit = IN_RANGE_128(digit, 9);
+    __m128i is_letter = IN_RANGE_128(letter, 5);
+    if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xFFFF)
+        return false;
+    *values = _mm_or_si128(_mm_and_si128(is_digit, digit),
+                           _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+    return true;
+}
+
+__attribute__((target("ssse3")))
+static size_t hex_decode_ssse3(uint8_t* src, size_t len, uint8_t* dst) {
+    size_t consumed = 0;
+    for (; len - consumed >= 32; consumed += 32, dst += 16) {
+        __m128i first, second;
+        if (!hex_values_ssse3(_mm_loadu_si128((__m128i*)(src + consumed)), &first)
+            || !hex_values_ssse3(_mm_loadu_si128((__m128i*)(src + consumed + 16)), &second))
+            break;
+        // Each pair of values becomes `high * 16 + low`
+        first = _mm_maddubs_epi16(first, _mm_set1_epi16(0x0110));
+        second = _mm_maddubs_epi16(second, _mm_set1_epi16(0x0110));
+        _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(first, second));
+    }
+    return consumed;
+}
+
+__attribute__((target("avx2")))
+static bool hex_values_avx2(__m256i in, __m256i* values) {
+    __m256i digit = _mm256_sub_epi8(in, _mm256_set1_epi8('0'));
+    __m256i letter = _mm256_sub_epi8(_mm256_or_si256(in, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i is_digit = IN_RANGE_256(digit, 9);
+    __m256i is_letter = IN_RANGE_256(letter, 5);
+    if (_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_letter)) != -1)
+        return false;
+    *values = _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+                              _mm256_and_si256(is_letter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+    return true;
+}
+
+__attribute__((target("avx2")))
+static size_t hex_decode_avx2(uint8_t* src, size_t len, uint8_t* dst) {
+    size_t consumed = 0;
+    for (; len - consumed >= 64; consumed += 64, dst += 32) {
+        __m256i first, second;
+        if (!hex_values_avx2(_mm256_loadu_si256((__m256i*)(src + consumed)), &first)
+            || !hex_values_avx2(_mm256_loadu_si256((__m256i*)(src + consumed + 32)), &second))
+            break;
+        first = _mm256_maddubs_epi16(first, _mm256_set1_epi16(0x0110));
+        second = _mm256_maddubs_epi16(second, _mm256_set1_epi16(0x0110));
+        // Packing works within lanes, so the quarters are put back in order
+        __m256i packed = _mm256_packus_epi16(first, second);
+        _mm256_storeu_si256((__m256i*)dst, _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    return consumed;
+}
+#endif
+
+bool str_base64_encode(str src, Base64Alphabet alphabet, dynstr* dst) {
+    uint8_t* in = (uint8_t*)src.data;
+    size_t len = src.len;
+    size_t remainder = len % 3;
+    size_t out_len = len / 3 * 4;
+    if (remainder > 0)
+        out_len += alphabet == Base64Standard ? 4 : remainder + 1;
+    char* out = reserve_output(dst, out_len);
+    if (out == NULL)
+        return false;
+
+    size_t consumed = 0;
+#ifdef STR_X86_SIMD
+    if (__builtin_cpu_supports("avx2"))
+        consumed = base64_encode_avx2(in, len, out, alphabet);
+    if (__builtin_cpu_supports("ssse3"))
+        consumed += base64_encode_ssse3(in + consumed, len - consumed, out + consumed / 3 * 4, alphabet);
+#endif
+
+    const char* chars = base64_chars[alphabet];
+    char* pos = out + consumed / 3 * 4;
+    for (; len - consumed >= 3; consumed += 3) {
+        uint32_t group = (in[consumed] << 16) | (in[consumed + 1] << 8) | in[consumed + 2];
+        *pos++ = chars[group >> 18];
+        *pos++ = chars[(group >> 12) & 0x3F];
+        *pos++ = chars[(group >> 6) & 0x3F];
+        *pos++ = chars[group & 0x3F];
+    }
+    if (remainder > 0) {
+        uint32_t group = in[consumed] << 16;
+        if (remainder == 2)
+            group |= in[consumed + 1] << 8;
+        *pos++ = chars[group >> 18];
+        *pos++ = chars[(group >> 12) & 0x3F];
+        if (remainder == 2)
+            *pos++ = chars[(group >> 6) & 0x3F];
+        if (alphabet == Base64Standard) {
+            *pos++ = '=';
+            if (remainder == 1)
+                *pos++ = '=';
+        }
+    }
+
+    dst->len += out_len;
+    dst->data[dst->len] = '\0';
+    return true;
+}
+
+bool str_base64_decode(str src, Base64Alphabet alphabet, dynstr* dst) {
+    pthread_once(&decode_tables_once, init_decode_tables);
+    uint8_t* in = (uint8_t*)src.data;
+    size_t len = src.len;
+    // Padding is required by the standard alphabet, and not allowed by the URL-safe one
+    if (alphabet == Base64Standard) {
+        if (len % 4 != 0)
+            return false;
+        if (len > 0 && in[len - 1] == '=')
+            len--;
+        if (len > 0 && in[len - 1] == '=')
+            len--;
+    }
+    size_t remainder = len % 4;
+    if (remainder == 1)
+        return false;
+    size_t out_len = len / 4 * 3 + (remainder > 0 ? remainder - 1 : 0);
+    uint8_t* out = (uint8_t*)reserve_output(dst, out_len);
+    if (out == NULL)
+        return false;
+
+    size_t full_len = len - remainder;
+    size_t consumed = 0;
+#ifdef STR_X86_SIMD
+    if (__builtin_cpu_supports("avx2"))
+        consumed = base64_decode_avx2(in, full_len, out, alphabet);
+    if (__builtin_cpu_supports("ssse3"))
+        consumed += base64_decode_ssse3(in + consumed, full_len - consumed, out + consumed / 4 * 3, alphabet);
+#endif
+
+    int8_t* values = base64_values[alphabet];
+    uint8_t* pos = out + consumed / 4 * 3;
+    bool valid = true;
+    for (; consumed < full_len; consumed += 4) {
+        int32_t a = values[in[consumed]];
+        int32_t b = values[in[consumed + 1]];
+        int32_t c = values[in[consumed + 2]];
+        int32_t d = values[in[consumed + 3]];
+        // Invalid characters are negative, so they set the sign bit
+        if ((a | b | c | d) < 0) {
+            valid = false;
+            break;
+        }
+        uint32_t group = (a << 18) | (b << 12) | (c << 6) | d;
+        *pos++ = group >> 16;
+        *pos++ = (group >> 8) & 0xFF;
+        *pos++ = group & 0xFF;
+    }
+    if (valid && remainder > 0) {
+        int32_t a = values[in[consumed]];
+        int32_t b = values[in[consumed + 1]];
+        int32_t c = remainder == 3 ? values[in[consumed + 2]] : 0;
+        // The bits past the last whole byte must be zero
+        int32_t trailing_bits = remainder == 3 ? c & 0x03 : b & 0x0F;
+        if ((a | b | c) < 0 || trailing_bits != 0)
+            valid = false;
+        else {
+            uint32_t group = (a << 18) | (b << 12) | (c << 6);
+            *pos++ = group >> 16;
+            if (remainder == 3)
+                *pos++ = (group >> 8) & 0xFF;
+        }
+    }
+
+    if (valid)
+        dst->len += out_len;
+    dst->data[dst->len] = '\0';
+    return valid;
+}
+
+bool str_hex_encode(str src, dynstr* dst) {
+    uint8_t* in = (uint8_t*)src.data;
+    size_t len = src.len;
+    char* out = reserve_output(dst, len * 2);
+    if (out == NULL)
+        return false;
+
+    size_t consumed = 0;
+#ifdef STR_X86_SIMD
+    if (__builtin_cpu_supports("avx2"))
+        consumed = hex_encode_avx2(in, len, out);
+    if (__builtin_cpu_supports("ssse3"))
+        consumed += hex_encode_ssse3(in + consumed, len - consumed, out + consumed * 2);
+#endif
+    for (; consumed < len; consumed++) {
+        out[consumed * 2] = hex_chars[in[consumed] >> 4];
+        out[consumed * 2 + 1] = hex_chars[in[consumed] & 0x0F];
+    }
+
+    dst->len += len * 2;
+    dst->data[dst->len] = '\0';
+    return true;
+}
+
+bool str_hex_decode(str src, dynstr* dst) {
+    pthread_once(&decode_tables_once, init_decode_tables);
+    uint8_t* in = (uint8_t*)src.data;
+    size_t len = src.len;
+    if (len % 2 != 0)
+        return false;
+    uint8_t* out = (uint8_t*)reserve_output(dst, len / 2);
+    if (out == NULL)
+        return false;
+
+    size_t consumed = 0;
+#ifdef STR_X86_SIMD
+    if (__builtin_cpu_supports("avx2"))
+        consumed = hex_decode_avx2(in, len, out);
+    if (__builtin_cpu_supports("ssse3"))
+        consumed += hex_decode_ssse3(in + consumed, len - consumed, out + consumed / 2);
+#endif
+    bool valid = true;
+    for (; consumed < len; consumed += 2) {
+        int32_t hi = hex_values[in[consumed]];
+        int32_t lo = hex_values[in[consumed + 1]];
+        if ((hi | lo) < 0) {
+            valid = false;
+            break;
+        }
+        out[consumed / 2] = (hi << 4) | lo;
+    }
+
+    if (valid)
+        dst->len += len / 2;
+    dst->data[dst->len] = '\0';
+    return valid;
+}
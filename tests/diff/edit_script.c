@@ -0,0 +1,90 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "diff.h"
+
+#define NUM_TRIALS 300
+#define MAX_LINES  40
+
+static char* words[] = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta"};
+
+// Length of the longest common subsequence, found the quadratic way
+static int lcs_len(str_arr a, str_arr b) {
+    int* prev = calloc(b.len + 1, sizeof(int));
+    int* cur = calloc(b.len + 1, sizeof(int));
+    for (int i = 1; i <= a.len; i++) {
+        for (int j = 1; j <= b.len; j++) {
+            if (str_compare(a.data[i - 1], b.data[j - 1]) == 0)
+                cur[j] = prev[j - 1] + 1;
+            else
+                cur[j] = prev[j] > cur[j - 1] ? prev[j] : cur[j - 1];
+        }
+        int* tmp = prev;
+        prev = cur;
+        cur = tmp;
+    }
+    int len = prev[b.len];
+    free(prev);
+    free(cur);
+    return len;
+}
+
+static str_arr random_lines(int max_words) {
+    str_arr lines = str_arr_create();
+    int len = rand() % (MAX_LINES + 1);
+    for (int i = 0; i < len; i++)
+        str_arr_append(&lines, STR(words[rand() % max_words]));
+    return lines;
+}
+
+int main() {
+    srand(42);
+    for (int trial = 0; trial < NUM_TRIALS; trial++) {
+        // Few distinct words make many lines repeat, which is the hard case
+        str_arr old_lines = random_lines(trial % 5 + 2);
+        str_arr new_lines = random_lines(trial % 5 + 2);
+        diff_edit_arr edits = diff_lines(old_lines, new_lines);
+
+        // Applying the edit script to the old lines gives the new lines
+        int old_pos = 0;
+        int new_pos = 0;
+        int num_equal = 0;
+        for (int i = 0; i < edits.len; i++) {
+            DiffEdit edit = edits.data[i];
+            ASSERT(edit.len > 0, "Empty edit");
+            ASSERT(i == 0 || edits.data[i - 1].op != edit.op, "Consecutive edits with the same op");
+            ASSERT(edit.old_start == old_pos && edit.new_start == new_pos, "Edit out of place");
+            if (edit.op == DiffEqual) {
+                for (int j = 0; j < edit.len; j++)
+                    ASSERT(str_compare(old_lines.data[old_pos + j], new_lines.data[new_pos + j]) == 0,
+                           "Unequal lines in an equal edit");
+                num_equal += edit.len;
+            }
+            if (edit.op != DiffInsert)
+                old_pos += edit.len;
+            if (edit.op != DiffDelete)
+                new_pos += edit.len;
+        }
+        ASSERT(old_pos == old_lines.len && new_pos == new_lines.len, "Edit script doesn't cover every line");
+        // And is as short as possible
+        ASSERT(num_equal == lcs_len(old_lines, new_lines), "Edit script isn't minimal");
+        bool identical = num_equal == old_lines.len && num_equal == new_lines.len;
+        ASSERT(diff_has_changes(edits) != identical, "Wrong change detection");
+
+        vec_DiffEdit_free(edits);
+        str_arr_free(old_lines);
+        str_arr_free(new_lines);
+    }
+
+    // Identical inputs have no changes
+    str_arr lines = str_arr_create();
+    str_arr_append(&lines, STR("same"));
+    str_arr_append(&lines, STR("lines"));
+    diff_edit_arr edits = diff_lines(lines, lines);
+    ASSERT(edits.len == 1 && edits.data[0].op == DiffEqual && !diff_has_changes(edits), "Identical inputs differ");
+    vec_DiffEdit_free(edits);
+    str_arr_free(lines);
+    puts("edit scripts are minimal");
+    PASS;
+}
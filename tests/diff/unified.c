@@ -0,0 +1,86 @@
+#include <stdlib.h>
+
+#include "test.h"
+#include "diff.h"
+#include "file.h"
+
+#define OLD_PATH  "/tmp/fiesta_diff_old.txt"
+#define NEW_PATH  "/tmp/fiesta_diff_new.txt"
+#define DIFF_PATH "/tmp/fiesta_diff.patch"
+
+static void write_file(char* path, char* contents) {
+    File file = file_open(STR(path), FileWrite | FileTruncate | FileBinary);
+    file_write_str(&file, STR(contents));
+    file_close(&file);
+}
+
+// Print the unified diff between two files, returning what `diff_files` did.
+static int print_diff(DiffOptions options) {
+    File old_file = file_open(STR(OLD_PATH), FileRead | FileBinary);
+    File new_file = file_open(STR(NEW_PATH), FileRead | FileBinary);
+    File output = file_open(STR(DIFF_PATH), FileWrite | FileTruncate | FileBinary);
+    int result = diff_files(&old_file, &new_file, &output, options);
+    file_close(&old_file);
+    file_close(&new_file);
+    file_close(&output);
+
+    output = file_open(STR(DIFF_PATH), FileRead | FileBinary);
+    str patch = file_read_all(&output);
+    str_print(patch);
+    free(patch.data);
+    file_close(&output);
+    return result;
+}
+
+int main() {
+    write_file(OLD_PATH, "one\ntwo\nthree\nfour\nfive\nsix\nseven\neight\nnine\nten\n"
+                         "eleven\ntwelve\nthirteen\nfourteen\nfifteen\n");
+    write_file(NEW_PATH, "zero\none\ntwo\nthree\nfour\nfive\nsix\nSEVEN\neight\nnine\nten\n"
+                         "eleven\ntwelve\nthirteen\nfifteen\nsixteen\n");
+    // Changes whose context overlaps share a hunk
+    DiffOptions options = {.old_label = STR("old.txt"), .new_label = STR("new.txt")};
+    ASSERT(print_diff(options) == 1, "Files should differ");
+    // And are in separate hunks otherwise
+    options.context = 2;
+    ASSERT(print_diff(options) == 1, "Files should differ");
+    options = (DiffOptions){.context = -1};
+    ASSERT(print_diff(options) == 1, "Files should differ");
+
+    // Diffs against empty files, and of identical files (which write nothing)
+    write_file(OLD_PATH, "");
+    write_file(NEW_PATH, "only line");
+    ASSERT(print_diff((DiffOptions){0}) == 1, "Files should differ");
+    write_file(OLD_PATH, "only line");
+    ASSERT(print_diff((DiffOptions){0}) == 0, "Files shouldn't differ");
+
+    // A missing newline at the end is a change, and is marked (like in `diff`)
+    write_file(OLD_PATH, "a\nb\nc");
+    write_file(NEW_PATH, "a\nb\nc\n");
+    ASSERT(print_diff((DiffOptions){0}) == 1, "Files should differ");
+    write_file(OLD_PATH, "a\nb\nc\nd");
+    write_file(NEW_PATH, "a\nB\nc\nd");
+    ASSERT(print_diff((DiffOptions){.context = 2}) == 1, "Files should differ");
+
+    // Edit scripts of string arrays can be written directly
+    str old_words[] = {STR("the"), STR("quick"), STR("brown"), STR("fox"), {0}};
+    str new_words[] = {STR("the"), STR("slow"), STR("brown"), STR("fox"), STR("jumps"), {0}};
+    str_arr old_lines = STRARR(old_words);
+    str_arr new_lines = STRARR(new_words);
+    diff_edit_arr edits = diff_lines(old_lines, new_lines);
+    File output = file_open(STR(DIFF_PATH), FileWrite | FileTruncate | FileBinary);
+    ASSERT(diff_write_unified(&output, old_lines, new_lines, edits, (DiffOptions){.context = 1}), "Write failed");
+    file_close(&output);
+    output = file_open(STR(DIFF_PATH), FileRead | FileBinary);
+    str patch = file_read_all(&output);
+    str_print(patch);
+    free(patch.data);
+    file_close(&output);
+    vec_DiffEdit_free(edits);
+    str_arr_free(old_lines);
+    str_arr_free(new_lines);
+
+    remove(OLD_PATH);
+    remove(NEW_PATH);
+    remove(DIFF_PATH);
+    PASS;
+}
@@ -0,0 +1,32 @@
+#include "test.h"
+#include "dir.h"
+
+void print_listing(DirWalkOptions options) {
+    DirListing listing = dir_walk(STR("tests/dir/tree"), options);
+    str_arr_print(listing.paths);
+    dir_listing_free(&listing);
+}
+
+int main() {
+    DirWalkOptions options = {.sorted = true};
+    print_listing(options);
+
+    options.include_hidden = true;
+    options.include_directories = true;
+    print_listing(options);
+
+    options = (DirWalkOptions){.sorted = true, .extension = STR(".txt"), .max_depth = 2};
+    print_listing(options);
+
+    options = (DirWalkOptions){.sorted = true, .name_pattern = STR("[bc].*"), .num_threads = 1};
+    print_listing(options);
+
+    options = (DirWalkOptions){.sorted = true, .min_size = 8, .max_size = 12};
+    print_listing(options);
+
+    DirListing listing = dir_walk(STR("tests/dir/missing"), options);
+    ASSERT(listing.paths.len == 0, "Walking a missing directory listed paths");
+    dir_listing_free(&listing);
+
+    PASS;
+}
@@ -0,0 +1,27 @@
+#include "test.h"
+#include "dir.h"
+
+bool add_size(DirEntry entry, void* context) {
+    *(int64_t*)context += entry.size;
+    return true;
+}
+
+bool stop_at_first(DirEntry entry, void* context) {
+    (*(int*)context)++;
+    return false;
+}
+
+int main() {
+    int64_t total_size = 0;
+    DirWalkOptions options = {.stat_entries = true, .include_hidden = true};
+    ASSERT(dir_walk_each(STR("tests/dir/tree"), options, add_size, &total_size), "Walk failed");
+    printf("%d\n", (int)total_size);
+
+    int num_seen = 0;
+    ASSERT(!dir_walk_each(STR("tests/dir/tree"), options, stop_at_first, &num_seen), "Walk wasn't stopped");
+    printf("%d\n", num_seen);
+
+    ASSERT(!dir_walk_each(STR("tests/dir/missing"), options, add_size, &total_size), "Walking a missing directory succeeded");
+
+    PASS;
+}
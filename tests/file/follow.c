@@ -0,0 +1,108 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "test.h"
+#include "file.h"
+
+#define FOLLOW_PATH "/tmp/fiesta_follow.log"
+#define ROTATED_PATH "/tmp/fiesta_follow.log.1"
+#define LATER_DIR "/tmp/fiesta_follow_later"
+#define LATER_PATH LATER_DIR "/later.log"
+
+void append(char* text, FileAccessModes modes) {
+    File file = file_open(STR(FOLLOW_PATH), modes);
+    file_write_str(&file, STR(text));
+    file_close(&file);
+}
+
+void* append_later(void* arg) {
+    nanosleep(&(struct timespec){.tv_nsec = 50000000}, NULL);
+    append(arg, FileAppend);
+    return NULL;
+}
+
+void* create_later(void* arg) {
+    nanosleep(&(struct timespec){.tv_nsec = 50000000}, NULL);
+    mkdir(LATER_DIR, 0755);
+    File file = file_open(STR(LATER_PATH), FileWrite);
+    file_write_str(&file, STR(arg));
+    file_close(&file);
+    return NULL;
+}
+
+bool print_line(FileFollower* follower, int timeout_ms) {
+    Optional(str) line = file_follow_read_line(follower, timeout_ms);
+    if (line.is_none)
+        return false;
+    str_println(line.val);
+    free(line.val.data);
+    return true;
+}
+
+int main() {
+    remove(FOLLOW_PATH);
+    remove(ROTATED_PATH);
+    append("skipped\n", FileWrite);
+
+    FileFollower follower = file_follow(STR(FOLLOW_PATH), true);
+    ASSERT(!print_line(&follower, 0), "Line read from before the end");
+
+    append("one\ntwo\nthr", FileAppend);
+    ASSERT(print_line(&follower, 0), "Appended line not read");
+    ASSERT(print_line(&follower, 0), "Appended line not read");
+    ASSERT(!print_line(&follower, 20), "Incomplete line read");
+    append("ee\n", FileAppend);
+    ASSERT(print_line(&follower, 1000), "Completed line not read");
+
+    // Blocks until another thread appends
+    pthread_t thread;
+    pthread_create(&thread, NULL, append_later, "four\n");
+    ASSERT(print_line(&follower, 5000), "Waiting for a line failed");
+    pthread_join(thread, NULL);
+
+    // Truncation
+    append("five\n", FileWrite | FileTruncate);
+    ASSERT(print_line(&follower, 1000), "Line after truncation not read");
+
+    // Rotation
+    rename(FOLLOW_PATH, ROTATED_PATH);
+    ASSERT(!print_line(&follower, 20), "Line read while rotated away");
+    append("six\nseven\n", FileWrite);
+    ASSERT(print_line(&follower, 1000), "Line after rotation not read");
+    ASSERT(print_line(&follower, 1000), "Line after rotation not read");
+
+    // An incomplete line is returned on its own once its file is rotated
+    append("eig", FileAppend);
+    ASSERT(!print_line(&follower, 20), "Incomplete line read");
+    remove(ROTATED_PATH);
+    rename(FOLLOW_PATH, ROTATED_PATH);
+    append("nine\n", FileWrite);
+    ASSERT(print_line(&follower, 1000), "Rotated file's last line not read");
+    ASSERT(print_line(&follower, 1000), "Line after rotation not read");
+
+    file_follow_close(&follower);
+    remove(FOLLOW_PATH);
+    remove(ROTATED_PATH);
+
+    // Without a directory to watch, the file is polled for
+    remove(LATER_PATH);
+    rmdir(LATER_DIR);
+    follower = file_follow(STR(LATER_PATH), false);
+    ASSERT(!print_line(&follower, 20), "Line read from a missing file");
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&thread, NULL, create_later, "ten\n");
+    ASSERT(print_line(&follower, 5000), "Line in a new directory not read");
+    pthread_join(thread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ASSERT(end.tv_sec - start.tv_sec < 2, "Line in a new directory read late");
+    file_follow_close(&follower);
+    remove(LATER_PATH);
+    rmdir(LATER_DIR);
+    PASS;
+}
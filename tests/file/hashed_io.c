@@ -0,0 +1,53 @@
+#include <stdlib.h>
+
+#include "test.h"
+#include "file.h"
+#include "hash.h"
+
+#define HASHED_PATH "/tmp/fiesta_hashed_io.txt"
+
+int main() {
+    // Bytes written through a file update its hasher
+    File file = file_open(STR(HASHED_PATH), FileWrite | FileTruncate | FileBinary);
+    ASSERT(file_is_open(file), "File open failed");
+    Hasher written = hasher_create(HashCrc32c, 0);
+    file_attach_hasher(&file, &written);
+    file_write_str(&file, STR("first line\nsecond line\n"));
+    uint32_t numbers[] = {1, 2, 3, 4};
+    file_write_u32(&file, numbers, 4);
+    file_write_str(&file, STR("\nlast line"));
+    file_close(&file);
+
+    // And so do bytes read through it, however they're read
+    file = file_open(STR(HASHED_PATH), FileRead | FileBinary);
+    ASSERT(file_is_open(file), "File open failed");
+    str contents = file_read_all(&file);
+    ASSERT(hasher_digest(&written) == hash_crc32c(contents), "Written checksum mismatch");
+
+    file_rewind(&file);
+    Hasher read = hasher_create(HashCrc32c, 0);
+    file_attach_hasher(&file, &read);
+    str line = file_read_line(&file);
+    str_println(line);
+    free(line.data);
+    str piece = file_read_str(&file, 12);
+    uint32_t read_numbers[4];
+    file_read_u32(&file, read_numbers, 4);
+    str rest = file_read_all(&file);
+    ASSERT(hasher_digest(&read) == hasher_digest(&written), "Read checksum mismatch");
+    str_println(rest);
+
+    // Detached hashers aren't updated
+    file_attach_hasher(&file, NULL);
+    file_rewind(&file);
+    str again = file_read_all(&file);
+    ASSERT(hasher_digest(&read) == hasher_digest(&written), "Detached hasher was updated");
+    file_close(&file);
+
+    free(again.data);
+    free(rest.data);
+    free(piece.data);
+    free(contents.data);
+    remove(HASHED_PATH);
+    PASS;
+}
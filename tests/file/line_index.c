@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "file.h"
+
+#define INDEXED_PATH "/tmp/fiesta_line_index.txt"
+#define SIDECAR_PATH "/tmp/fiesta_line_index.idx"
+#define NUM_LINES    2000
+
+// Lines of varying lengths (including empty ones and ones spanning several SIMD blocks)
+static void write_line(File* file, int i, bool newline) {
+    char line[256];
+    int len = snprintf(line, sizeof(line), "line %d ", i);
+    for (int j = 0; j < (i * 37) % 150; j++)
+        line[len++] = 'a' + (i + j) % 26;
+    if (i % 11 == 0)
+        len = 0;
+    if (newline)
+        line[len++] = '\n';
+    file_write_str(file, (str){.data = line, .len = len});
+}
+
+static bool check_line(File* file, FileLineIndex* index, int i) {
+    Optional(str) line = file_read_line_at(file, index, i);
+    if (line.is_none)
+        return false;
+    char expected[256];
+    int len = 0;
+    if (i % 11 != 0) {
+        len = snprintf(expected, sizeof(expected), "line %d ", i);
+        for (int j = 0; j < (i * 37) % 150; j++)
+            expected[len++] = 'a' + (i + j) % 26;
+    }
+    bool matches = line.val.len == len && memcmp(line.val.data, expected, len) == 0;
+    free(line.val.data);
+    return matches;
+}
+
+int main() {
+    File file = file_open(STR(INDEXED_PATH), FileWrite | FileTruncate | FileBinary);
+    ASSERT(file_is_open(file), "File open failed");
+    for (int i = 0; i < NUM_LINES; i++)
+        write_line(&file, i, true);
+    file_close(&file);
+
+    file = file_open(STR(INDEXED_PATH), FileRead | FileBinary);
+    FileLineIndex index = file_line_index_build(&file, 7);
+    printf("%ld lines, %d checkpoints\n", file_line_index_count(&index), index.checkpoints.len);
+    // Lines can be read in any order
+    for (int i = NUM_LINES - 1; i >= 0; i -= 3)
+        ASSERT(check_line(&file, &index, i), "Wrong line");
+    for (int i = 0; i < NUM_LINES; i++)
+        ASSERT(check_line(&file, &index, i), "Wrong line");
+    ASSERT(file_read_line_at(&file, &index, NUM_LINES).is_none, "Read past the last line");
+    ASSERT(!file_seek_line(&file, &index, -1), "Seeked to a negative line");
+    ASSERT(file_seek_line(&file, &index, 1), "Seek failed");
+    str line = file_read_line(&file);
+    str_println(line);
+    free(line.data);
+    file_close(&file);
+
+    // Appended lines are indexed incrementally, including a last line without a newline
+    file = file_open(STR(INDEXED_PATH), FileAppend | FileBinary);
+    for (int i = NUM_LINES; i < NUM_LINES + 10; i++)
+        write_line(&file, i, i < NUM_LINES + 9);
+    file_close(&file);
+    file = file_open(STR(INDEXED_PATH), FileRead | FileBinary);
+    int64_t indexed_size = index.indexed_size;
+    ASSERT(file_line_index_update(&file, &index), "Update failed");
+    ASSERT(file_line_index_count(&index) == NUM_LINES + 10, "Appended lines weren't indexed");
+    for (int i = 0; i < NUM_LINES + 10; i++)
+        ASSERT(check_line(&file, &index, i), "Wrong line");
+
+    // Saved indexes load back identically
+    ASSERT(file_line_index_save(&index, STR(SIDECAR_PATH)), "Save failed");
+    Optional(FileLineIndex) loaded = file_line_index_load(STR(SIDECAR_PATH));
+    ASSERT(!loaded.is_none, "Load failed");
+    ASSERT(loaded.val.checkpoints.len == index.checkpoints.len
+           && memcmp(loaded.val.checkpoints.data, index.checkpoints.data,
+                     index.checkpoints.len * sizeof(int64_t)) == 0
+           && loaded.val.indexed_size == index.indexed_size
+           && file_line_index_count(&loaded.val) == file_line_index_count(&index), "Loaded index differs");
+    ASSERT(file_line_index_update(&file, &loaded.val), "Update failed");
+    ASSERT(loaded.val.indexed_size == index.indexed_size, "Up to date index was rescanned");
+    ASSERT(check_line(&file, &loaded.val, NUM_LINES + 9), "Wrong last line");
+    file_line_index_free(&loaded.val);
+    file_close(&file);
+
+    // Corrupt sidecar files aren't loaded
+    file = file_open(STR(SIDECAR_PATH), FileRead | FileWrite | FileBinary);
+    uint8_t byte = 0xFF;
+    file_pwrite_u8(&file, 40, &byte, 1);
+    file_close(&file);
+    ASSERT(file_line_index_load(STR(SIDECAR_PATH)).is_none, "Loaded a corrupt index");
+    ASSERT(file_line_index_load(STR("/tmp/fiesta_no_such_index.idx")).is_none, "Loaded a missing index");
+
+    // Truncated files are indexed again from the start
+    file = file_open(STR(INDEXED_PATH), FileRead | FileWrite | FileTruncate | FileBinary);
+    file_write_str(&file, STR("only\nlines\n"));
+    ASSERT(file_line_index_update(&file, &index), "Update failed");
+    ASSERT(file_line_index_count(&index) == 2 && index.indexed_size < indexed_size, "Truncation wasn't detected");
+    file_close(&file);
+    file = file_open(STR(INDEXED_PATH), FileRead | FileBinary);
+    line = file_read_line_at(&file, &index, 1).val;
+    str_println(line);
+    free(line.data);
+    file_close(&file);
+
+    file_line_index_free(&index);
+    remove(INDEXED_PATH);
+    remove(SIDECAR_PATH);
+    PASS;
+}
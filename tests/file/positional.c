@@ -0,0 +1,61 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "test.h"
+#include "file.h"
+
+#define NUM_THREADS 4
+#define NUM_VALUES  1024
+
+File file;
+
+void* read_values(void* arg) {
+    intptr_t thread = (intptr_t)arg;
+    for (int i = thread; i < NUM_VALUES; i += NUM_THREADS) {
+        uint32_t value;
+        if (file_pread(&file, i * sizeof(uint32_t), &value, 1) != 1 || value != (uint32_t)i * 3)
+            return (void*)1;
+    }
+    return NULL;
+}
+
+int main() {
+    file = file_open(STR("tests/file/positional.bin"), FileRead | FileWrite | FileTruncate | FileBinary);
+    ASSERT(file_is_open(file), "File open failed");
+
+    uint32_t values[NUM_VALUES];
+    for (int i = 0; i < NUM_VALUES; i++)
+        values[i] = i * 3;
+    ASSERT(file_pwrite_u32(&file, 0, values, NUM_VALUES) == NUM_VALUES, "Positional write failed");
+    ASSERT(file_get_position(file) == 0, "Positional write moved the position");
+
+    pthread_t threads[NUM_THREADS];
+    for (intptr_t i = 0; i < NUM_THREADS; i++)
+        pthread_create(&threads[i], NULL, read_values, (void*)i);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        void* result;
+        pthread_join(threads[i], &result);
+        ASSERT(result == NULL, "Positional read returned the wrong value");
+    }
+
+    // Reads past the end only return the elements that exist
+    uint32_t tail[4];
+    printf("%d\n", (int)file_pread_u32(&file, (NUM_VALUES - 2) * sizeof(uint32_t), tail, 4));
+    printf("%u %u\n", tail[0], tail[1]);
+
+    ASSERT(file_pwrite_str(&file, 4, STR("fiesta")) == 6, "Positional string write failed");
+    str text = file_pread_str(&file, 4, 6);
+    str_println(text);
+    free(text.data);
+    text = file_pread_str(&file, 4, -1);
+    ASSERT(text.data == NULL && text.len == 0, "Positional read of a negative size succeeded");
+
+    int16_t halves[2];
+    ASSERT(file_pread_i16(&file, 0, halves, 2) == 2, "Positional read failed");
+    printf("%d %d\n", halves[0], halves[1]);
+    ASSERT(file_get_position(file) == 0, "Positional read moved the position");
+
+    file_close(&file);
+    remove("tests/file/positional.bin");
+    PASS;
+}
@@ -0,0 +1,40 @@
+#include <stdlib.h>
+
+#include "test.h"
+#include "file.h"
+
+int main() {
+    File file = file_open(STR("tests/file/test_lines.txt"), FileRead | FileBinary);
+    ASSERT(file_is_open(file), "File open failed");
+
+    FileStat stat = file_stat(&file);
+    ASSERT(stat.is_regular && !stat.is_directory, "File stat failed");
+    ASSERT(stat.size == file_get_length(&file), "File stat size mismatch");
+    printf("%d\n", (int)stat.size);
+
+    ASSERT(file_advise(&file, FileHintSequential, 0, 0), "File advise failed");
+    ASSERT(file_advise(&file, FileHintWillNeed, 0, 0), "File advise failed");
+    file_seek(&file, 5, FilePositionStart);
+    str text = file_read_all(&file);
+    ASSERT(text.len == stat.size - 5, "Read all length mismatch");
+    ASSERT(file_get_position(file) == stat.size, "File position not updated");
+    str_println(text);
+    free(text.data);
+
+    // Reading at the end of a file gives an empty string
+    text = file_read_all(&file);
+    ASSERT(text.len == 0, "Read all past the end failed");
+    free(text.data);
+    file_close(&file);
+
+    // Direct reads fall back to buffered reads if they're unsupported
+    file = file_open(STR("tests/file/test_lines.txt"), FileRead | FileBinary | FileDirect);
+    ASSERT(file_is_open(file), "File open failed");
+    text = file_read_all(&file);
+    ASSERT(text.len == stat.size, "Direct read all length mismatch");
+    str_println(text);
+    free(text.data);
+    file_close(&file);
+
+    PASS;
+}
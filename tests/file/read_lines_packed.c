@@ -0,0 +1,24 @@
+#include "test.h"
+#include "file.h"
+
+int main() {
+    File file = file_open(STR("tests/file/test_lines.txt"), FileRead | FileText);
+    ASSERT(file_is_open(file), "File open failed");
+
+    Optional(str_pack) read = file_read_lines_packed(&file);
+    ASSERT(!read.is_none, "Reading lines failed");
+    str_pack lines = read.val;
+    for (int i = 0; i < str_pack_len(lines); i++)
+        str_println(str_pack_get(lines, i));
+    ASSERT(file_get_position(file) == file_get_length(&file), "File position not updated");
+
+    str_pack_free(lines);
+    file_close(&file);
+
+    // Reading fails on a file that isn't open for reading
+    file = file_open(STR("tests/file/test_lines.txt"), FileAppend | FileText);
+    ASSERT(file_is_open(file), "File open failed");
+    ASSERT(file_read_lines_packed(&file).is_none, "Reading a write-only file succeeded");
+    file_close(&file);
+    PASS;
+}
@@ -11,6 +11,10 @@ int main() {
     str_println(text);
     free(text.data);
 
+    // Sizes that can't be allocated give an empty string
+    text = file_read_str(&file, -1);
+    ASSERT(text.data == NULL && text.len == 0, "Invalid size read");
+
     file_close(&file);
     PASS;
 }
\ No newline at end of file
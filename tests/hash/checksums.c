@@ -0,0 +1,43 @@
+#include <stdlib.h>
+
+#include "test.h"
+#include "hash.h"
+#include "str.h"
+
+int main() {
+    // Standard check values
+    printf("%08x\n", hash_crc32c(STR("123456789")));
+    printf("%016llx\n", (unsigned long long)hash_xxh64(STR(""), 0));
+    printf("%016llx\n", (unsigned long long)hash_xxh64(STR("abc"), 0));
+    printf("%016llx\n", (unsigned long long)hash_xxh64(STR("Nobody inspects the spammish repetition"), 0));
+
+    // `str` and `dynstr` hash the same
+    dynstr text = DSTR("The quick brown fox jumps over the lazy dog");
+    ASSERT(hash_crc32c(text) == hash_crc32c_bytes(text.data, text.len), "CRC32C of dynstr differs");
+    ASSERT(hash_xxh64(text, 42) == hash_xxh64_bytes(text.data, text.len, 42), "XXH64 of dynstr differs");
+    ASSERT(hash_xxh64(text, 42) != hash_xxh64(text, 0), "Seed had no effect");
+
+    // Checksums can be continued across pieces of a buffer (long enough to
+    // use every block size), and match a bitwise CRC
+    size_t len = 100000;
+    uint8_t* data = malloc(len);
+    for (size_t i = 0; i < len; i++)
+        data[i] = (i * 2654435761u) >> 13;
+    for (size_t offset = 0; offset < 8; offset++) {
+        uint32_t expected = 0xFFFFFFFF;
+        for (size_t i = offset; i < len; i++) {
+            expected ^= data[i];
+            for (int j = 0; j < 8; j++)
+                expected = (expected >> 1) ^ (0x82F63B78 & -(expected & 1));
+        }
+        expected = ~expected;
+        ASSERT(hash_crc32c_bytes(data + offset, len - offset) == expected, "CRC32C mismatch");
+        size_t split = len / 3 + offset * 77;
+        uint32_t crc = hash_crc32c_update(0, data + offset, split - offset);
+        ASSERT(hash_crc32c_update(crc, data + split, len - split) == expected, "Continued CRC32C mismatch");
+    }
+
+    free(data);
+    dynstr_free(text);
+    PASS;
+}
@@ -0,0 +1,42 @@
+#include <stdlib.h>
+
+#include "test.h"
+#include "hash.h"
+#include "str.h"
+
+int main() {
+    size_t len = 5000;
+    uint8_t* data = malloc(len);
+    for (size_t i = 0; i < len; i++)
+        data[i] = (i * 31) ^ (i >> 3);
+
+    // Any way of splitting the input gives the same digest as hashing it at once
+    Hasher xxh64 = hasher_create(HashXxh64, 7);
+    Hasher crc32c = hasher_create(HashCrc32c, 0);
+    size_t piece_lens[] = {0, 1, 3, 31, 32, 33, 64, 100, 7};
+    for (size_t pos = 0, i = 0; pos < len; i++) {
+        size_t piece_len = piece_lens[i % (sizeof(piece_lens) / sizeof(piece_lens[0]))];
+        if (piece_len > len - pos)
+            piece_len = len - pos;
+        hasher_update(&xxh64, data + pos, piece_len);
+        hasher_update(&crc32c, data + pos, piece_len);
+        pos += piece_len;
+        // Taking a digest doesn't disturb the hasher
+        ASSERT(hasher_digest(&xxh64) == hash_xxh64_bytes(data, pos, 7), "Partial XXH64 mismatch");
+    }
+    ASSERT(hasher_digest(&xxh64) == hash_xxh64_bytes(data, len, 7), "XXH64 mismatch");
+    ASSERT(hasher_digest(&crc32c) == hash_crc32c_bytes(data, len), "CRC32C mismatch");
+
+    // A reset hasher starts over
+    hasher_reset(&xxh64);
+    hasher_reset(&crc32c);
+    hasher_update(&xxh64, "abc", 3);
+    hasher_update(&crc32c, "123456789", 9);
+    printf("%016llx\n", (unsigned long long)hasher_digest(&xxh64));
+    printf("%08llx\n", (unsigned long long)hasher_digest(&crc32c));
+    hasher_reset(&xxh64);
+    printf("%016llx\n", (unsigned long long)hasher_digest(&xxh64));
+
+    free(data);
+    PASS;
+}
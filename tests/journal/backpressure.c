@@ -0,0 +1,54 @@
+#include <stdlib.h>
+
+#include "test.h"
+#include "journal.h"
+
+#define NUM_RECORDS  2000
+#define MAX_PENDING  1024
+#define JOURNAL_PATH "tests/journal/backpressure.journal"
+
+int main() {
+    remove(JOURNAL_PATH);
+    // A long latency keeps batches open, so appends have to wait for the committer
+    JournalOptions options = {.max_batch_bytes = 512, .max_latency_us = 100000, .max_pending_bytes = MAX_PENDING};
+    Journal* journal = journal_open(STR(JOURNAL_PATH), options);
+    ASSERT(journal != NULL, "Journal open failed");
+
+    char record[32];
+    uint64_t ticket = 0;
+    int64_t max_pending = 0;
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        int len = snprintf(record, sizeof(record), "record %d", i);
+        ticket = journal_append(journal, (str){.data = record, .len = len});
+        int64_t pending = journal_pending_bytes(journal);
+        if (pending > max_pending)
+            max_pending = pending;
+    }
+    ASSERT(max_pending <= MAX_PENDING, "Pending batch grew past its limit");
+    ASSERT(journal_wait(journal, ticket), "Record wasn't made durable");
+
+    // A record larger than the limit still goes into an empty batch
+    char* large = malloc(4 * MAX_PENDING);
+    memset(large, 'x', 4 * MAX_PENDING);
+    ASSERT(journal_append_sync(journal, (str){.data = large, .len = 4 * MAX_PENDING}), "Large record wasn't made durable");
+    free(large);
+    ASSERT(journal_close(journal), "Journal close failed");
+
+    File file = file_open(STR(JOURNAL_PATH), FileRead | FileBinary);
+    ASSERT(file_is_open(file), "File open failed");
+    int num_records = 0;
+    Optional(str) last = None(str);
+    Optional(str) next;
+    while (!(next = journal_read_record(&file)).is_none) {
+        if (!last.is_none)
+            free(last.val.data);
+        last = next;
+        num_records++;
+    }
+    printf("%d records, last is %d bytes\n", num_records, last.val.len);
+    free(last.val.data);
+    file_close(&file);
+
+    remove(JOURNAL_PATH);
+    PASS;
+}
@@ -0,0 +1,36 @@
+#include <stdlib.h>
+
+#include "test.h"
+#include "journal.h"
+
+#define JOURNAL_PATH "/tmp/fiesta_failed_batch.journal"
+
+int main() {
+    remove(JOURNAL_PATH);
+    // A long latency keeps every record below in the same batch
+    JournalOptions options = {.max_batch_bytes = 1 << 20, .max_latency_us = 100000};
+    Journal* journal = journal_open(STR(JOURNAL_PATH), options);
+    ASSERT(journal != NULL, "Journal open failed");
+    ASSERT(journal_append_sync(journal, STR("first")), "Append failed");
+
+    uint64_t before = journal_append(journal, STR("second"));
+    uint64_t invalid = journal_append(journal, (str){.data = "third", .len = -1});
+    uint64_t after = journal_append(journal, STR("fourth"));
+    ASSERT(!journal_wait(journal, before), "Record batched with an invalid one was made durable");
+    ASSERT(!journal_wait(journal, invalid), "Invalid record was made durable");
+    ASSERT(!journal_wait(journal, after), "Record batched with an invalid one was made durable");
+    ASSERT(!journal_append_sync(journal, STR("fifth")), "Record after a failed batch was made durable");
+    ASSERT(!journal_close(journal), "Journal close didn't report the failure");
+
+    File file = file_open(STR(JOURNAL_PATH), FileRead | FileBinary);
+    Optional(str) record;
+    while (!(record = journal_read_record(&file)).is_none) {
+        str_println(record.val);
+        free(record.val.data);
+    }
+    puts("end");
+    file_close(&file);
+
+    remove(JOURNAL_PATH);
+    PASS;
+}
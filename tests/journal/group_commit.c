@@ -0,0 +1,72 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "test.h"
+#include "journal.h"
+
+#define NUM_THREADS 4
+#define NUM_RECORDS 50
+#define JOURNAL_PATH "/tmp/fiesta_group_commit.journal"
+
+Journal* journal;
+
+void* append_records(void* arg) {
+    intptr_t thread = (intptr_t)arg;
+    char record[32];
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        int len = snprintf(record, sizeof(record), "thread %d record %d", (int)thread, i);
+        // Alternate between waiting on each record and only waiting on the last
+        if (thread % 2 == 0) {
+            if (!journal_append_sync(journal, (str){.data = record, .len = len}))
+                return (void*)1;
+        }
+        else {
+            uint64_t ticket = journal_append(journal, (str){.data = record, .len = len});
+            if (i == NUM_RECORDS - 1 && !journal_wait(journal, ticket))
+                return (void*)1;
+        }
+    }
+    return NULL;
+}
+
+int main() {
+    remove(JOURNAL_PATH);
+    JournalOptions options = {.max_batch_bytes = 4096, .max_latency_us = 500};
+    journal = journal_open(STR(JOURNAL_PATH), options);
+    ASSERT(journal != NULL, "Journal open failed");
+
+    pthread_t threads[NUM_THREADS];
+    for (intptr_t i = 0; i < NUM_THREADS; i++)
+        pthread_create(&threads[i], NULL, append_records, (void*)i);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        void* result;
+        pthread_join(threads[i], &result);
+        ASSERT(result == NULL, "Record wasn't made durable");
+    }
+
+    journal_append(journal, STR("last record"));
+    ASSERT(journal_close(journal), "Journal close failed");
+
+    // Every record is read back, with each thread's records in order
+    File file = file_open(STR(JOURNAL_PATH), FileRead | FileBinary);
+    ASSERT(file_is_open(file), "File open failed");
+    int next_record[NUM_THREADS] = {0};
+    int num_records = 0;
+    Optional(str) record;
+    while (!(record = journal_read_record(&file)).is_none) {
+        int thread, index;
+        if (sscanf(record.val.data, "thread %d record %d", &thread, &index) == 2) {
+            ASSERT(index == next_record[thread], "Records out of order");
+            next_record[thread]++;
+        }
+        else
+            str_println(record.val);
+        num_records++;
+        free(record.val.data);
+    }
+    printf("%d records\n", num_records);
+    file_close(&file);
+
+    remove(JOURNAL_PATH);
+    PASS;
+}
@@ -0,0 +1,35 @@
+#include <stdlib.h>
+
+#include "test.h"
+#include "journal.h"
+
+#define JOURNAL_PATH "/tmp/fiesta_torn_write.journal"
+
+int main() {
+    remove(JOURNAL_PATH);
+    Journal* journal = journal_open(STR(JOURNAL_PATH), (JournalOptions){0});
+    ASSERT(journal != NULL, "Journal open failed");
+    ASSERT(journal_append_sync(journal, STR("first")), "Append failed");
+    uint64_t ticket = journal_append(journal, STR("second"));
+    ASSERT(journal_wait(journal, ticket), "Wait failed");
+    ASSERT(journal_is_durable(journal, ticket), "Record isn't durable");
+    ASSERT(journal_close(journal), "Journal close failed");
+
+    // Simulate a crash partway through writing a record
+    File file = file_open(STR(JOURNAL_PATH), FileAppend | FileBinary);
+    uint8_t torn[] = {11, 0, 0, 0, 1, 2, 3, 4, 't', 'o', 'r'};
+    file_write_u8(&file, torn, sizeof(torn));
+    file_close(&file);
+
+    file = file_open(STR(JOURNAL_PATH), FileRead | FileBinary);
+    Optional(str) record;
+    while (!(record = journal_read_record(&file)).is_none) {
+        str_println(record.val);
+        free(record.val.data);
+    }
+    puts("end");
+    file_close(&file);
+
+    remove(JOURNAL_PATH);
+    PASS;
+}
@@ -0,0 +1,40 @@
+#include "test.h"
+#include "matcher.h"
+
+void print_matches(match_arr matches, str_arr patterns) {
+    for (int i = 0; i < matches.len; i++) {
+        Match match = matches.data[i];
+        printf("%s@%d ", patterns.data[match.pattern_id].data, (int)match.offset);
+    }
+    printf("\n");
+}
+
+int main() {
+    str_arr patterns = str_arr_create();
+    str_arr_append(&patterns, STR("he"));
+    str_arr_append(&patterns, STR("she"));
+    str_arr_append(&patterns, STR("his"));
+    str_arr_append(&patterns, STR("hers"));
+    str_arr_append(&patterns, STR(""));
+    str_arr_append(&patterns, STR("he"));
+
+    Matcher matcher = matcher_create(patterns, MatcherDefault);
+    ASSERT(matcher_is_valid(matcher), "Create failed");
+    match_arr matches = matcher_find_all(&matcher, STR("ushers and HIS history"));
+    print_matches(matches, patterns);
+    ASSERT(matcher_contains_any(&matcher, STR("this")), "Contains any failed");
+    ASSERT(!matcher_contains_any(&matcher, STR("nope")), "Contains any false positive");
+    vec_Match_free(matches);
+    matcher_free(&matcher);
+
+    matcher = matcher_create(patterns, MatcherCaseInsensitive);
+    matches = matcher_find_all(&matcher, STR("ushers and HIS history"));
+    print_matches(matches, patterns);
+    vec_Match_free(matches);
+    matcher_free(&matcher);
+    // Freed (like failed) matchers never match
+    ASSERT(!matcher_is_valid(matcher) && !matcher_contains_any(&matcher, STR("she")), "Freed matcher matched");
+
+    str_arr_free(patterns);
+    PASS;
+}
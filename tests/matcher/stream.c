@@ -0,0 +1,35 @@
+#include "test.h"
+#include "matcher.h"
+
+int main() {
+    str_arr patterns = str_arr_create();
+    str_arr_append(&patterns, STR("error"));
+    str_arr_append(&patterns, STR("timeout"));
+    str_arr_append(&patterns, STR("out"));
+    Matcher matcher = matcher_create(patterns, MatcherCaseInsensitive);
+
+    // Matches spanning chunk boundaries
+    MatchStream stream = matcher_stream_create(&matcher);
+    match_arr matches = vec_Match_create();
+    matcher_stream_feed(&stream, STR("an err"), &matches);
+    matcher_stream_feed(&stream, STR("or, then a time"), &matches);
+    matcher_stream_feed(&stream, STR("o"), &matches);
+    matcher_stream_feed(&stream, STR("ut"), &matches);
+    for (int i = 0; i < matches.len; i++)
+        printf("%d@%d+%d\n", matches.data[i].pattern_id, (int)matches.data[i].offset, matches.data[i].len);
+    vec_Match_free(matches);
+
+    File file = file_open(STR("tests/matcher/log.txt"), FileRead | FileBinary);
+    ASSERT(file_is_open(file), "File open failed");
+    file_seek(&file, 4, FilePositionStart);
+    matches = matcher_find_all_in_file(&matcher, &file);
+    for (int i = 0; i < matches.len; i++)
+        printf("%d@%d\n", matches.data[i].pattern_id, (int)matches.data[i].offset);
+    ASSERT(file_get_position(file) == file_get_length(&file), "File position not updated");
+    vec_Match_free(matches);
+    file_close(&file);
+
+    matcher_free(&matcher);
+    str_arr_free(patterns);
+    PASS;
+}
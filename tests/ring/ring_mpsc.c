@@ -0,0 +1,61 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "ring.h"
+
+#define NUM_PRODUCERS 4
+#define NUM_RECORDS   50000
+
+Ring* ring;
+
+void* produce(void* arg) {
+    intptr_t producer = (intptr_t)arg;
+    char buf[32];
+    str batch[4];
+    for (int i = 0; i < NUM_RECORDS;) {
+        // Odd producers push in batches
+        int count = producer % 2 == 0 ? 1 : 4;
+        for (int j = 0; j < count; j++) {
+            int len = snprintf(buf, sizeof(buf), "%d %d", (int)producer, i + j);
+            batch[j] = (str){.data = strdup(buf), .len = len};
+        }
+        if (count == 1 ? !ring_push(ring, batch[0]) : ring_push_n(ring, batch, count) != count)
+            return (void*)1;
+        i += count;
+    }
+    return NULL;
+}
+
+int main() {
+    ring = ring_create(64, RingMpsc);
+    ASSERT(ring != NULL, "Ring create failed");
+
+    pthread_t producers[NUM_PRODUCERS];
+    for (intptr_t i = 0; i < NUM_PRODUCERS; i++)
+        pthread_create(&producers[i], NULL, produce, (void*)i);
+
+    // Each producer's records come out in order
+    int next[NUM_PRODUCERS] = {0};
+    int total = 0;
+    str value;
+    while (total < NUM_PRODUCERS * NUM_RECORDS && ring_pop(ring, &value)) {
+        int producer, index;
+        ASSERT(sscanf(value.data, "%d %d", &producer, &index) == 2, "Malformed record");
+        ASSERT(index == next[producer], "Records out of order");
+        next[producer]++;
+        total++;
+        free(value.data);
+    }
+    for (int i = 0; i < NUM_PRODUCERS; i++) {
+        void* result;
+        pthread_join(producers[i], &result);
+        ASSERT(result == NULL, "Producer failed");
+    }
+    ASSERT(!ring_try_pop(ring, &value), "Ring wasn't emptied");
+    printf("%d records\n", total);
+
+    ring_free(ring);
+    PASS;
+}
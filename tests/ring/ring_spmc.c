@@ -0,0 +1,62 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "ring.h"
+
+#define NUM_CONSUMERS 4
+#define NUM_RECORDS   200000
+
+Ring* ring;
+atomic_llong sum;
+atomic_int count;
+
+void* consume(void* arg) {
+    intptr_t consumer = (intptr_t)arg;
+    str batch[8];
+    while (true) {
+        // Odd consumers pop in batches
+        int popped = 1;
+        if (consumer % 2 == 0) {
+            if (!ring_pop(ring, &batch[0]))
+                break;
+        }
+        else if ((popped = ring_pop_n(ring, batch, 8)) == 0)
+            break;
+        for (int i = 0; i < popped; i++) {
+            atomic_fetch_add(&sum, atoi(batch[i].data));
+            atomic_fetch_add(&count, 1);
+            free(batch[i].data);
+        }
+    }
+    return NULL;
+}
+
+int main() {
+    ring = ring_create(128, RingSpmc);
+    ASSERT(ring != NULL, "Ring create failed");
+
+    pthread_t consumers[NUM_CONSUMERS];
+    for (intptr_t i = 0; i < NUM_CONSUMERS; i++)
+        pthread_create(&consumers[i], NULL, consume, (void*)i);
+
+    char buf[32];
+    str batch[32];
+    for (int i = 0; i < NUM_RECORDS; i += 32) {
+        for (int j = 0; j < 32; j++) {
+            int len = snprintf(buf, sizeof(buf), "%d", i + j);
+            batch[j] = (str){.data = strdup(buf), .len = len};
+        }
+        ASSERT(ring_push_n(ring, batch, 32) == 32, "Push failed");
+    }
+    // Consumers drain the ring, then stop once it's closed
+    ring_close(ring);
+    for (int i = 0; i < NUM_CONSUMERS; i++)
+        pthread_join(consumers[i], NULL);
+
+    printf("%d records, sum %lld\n", atomic_load(&count), atomic_load(&sum));
+    ring_free(ring);
+    PASS;
+}
@@ -0,0 +1,78 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "ring.h"
+
+#define NUM_RECORDS 100000
+
+Ring* ring;
+
+void* produce(void* arg) {
+    char buf[32];
+    str batch[16];
+    for (int i = 0; i < NUM_RECORDS;) {
+        // Alternate between single and batched pushes
+        if (i % 3 == 0) {
+            int len = snprintf(buf, sizeof(buf), "%d", i);
+            if (!ring_push(ring, (str){.data = strdup(buf), .len = len}))
+                return (void*)1;
+            i++;
+            continue;
+        }
+        int count = 0;
+        for (; count < 16 && i + count < NUM_RECORDS; count++) {
+            int len = snprintf(buf, sizeof(buf), "%d", i + count);
+            batch[count] = (str){.data = strdup(buf), .len = len};
+        }
+        if (ring_push_n(ring, batch, count) != count)
+            return (void*)1;
+        i += count;
+    }
+    ring_close(ring);
+    return NULL;
+}
+
+int main() {
+    ring = ring_create(5, RingSpsc);
+    ASSERT(ring != NULL, "Ring create failed");
+
+    // Capacity is rounded up to 8
+    str value;
+    ASSERT(!ring_try_pop(ring, &value), "Empty ring popped");
+    str values[10];
+    for (int i = 0; i < 10; i++)
+        values[i] = STR("x");
+    ASSERT(ring_try_push_n(ring, values, 10) == 8, "Wrong batch push count");
+    ASSERT(!ring_try_push(ring, STR("y")), "Full ring pushed");
+    ASSERT(ring_try_pop_n(ring, values, 3) == 3, "Wrong batch pop count");
+    ASSERT(ring_try_push(ring, STR("y")), "Push after pop failed");
+    ASSERT(ring_try_pop_n(ring, values, 10) == 6, "Wrong batch pop count");
+    str_println(values[5]);
+
+    // Records come out in order while the ring wraps around many times
+    pthread_t producer;
+    pthread_create(&producer, NULL, produce, NULL);
+    int next = 0;
+    str batch[8];
+    int popped;
+    while ((popped = ring_pop_n(ring, batch, 8)) > 0) {
+        for (int i = 0; i < popped; i++) {
+            ASSERT(atoi(batch[i].data) == next, "Records out of order");
+            next++;
+            free(batch[i].data);
+        }
+    }
+    void* result;
+    pthread_join(producer, &result);
+    ASSERT(result == NULL, "Producer failed");
+    printf("%d records\n", next);
+
+    // Pushes fail once a ring is closed
+    ASSERT(!ring_push(ring, STR("z")), "Closed ring pushed");
+    ASSERT(!ring_pop(ring, &value), "Closed empty ring popped");
+
+    ring_free(ring);
+    PASS;
+}
@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "sort.h"
+
+#define INPUT_PATH  "/tmp/fiesta_sort_input.txt"
+#define OUTPUT_PATH "/tmp/fiesta_sort_output.txt"
+#define NUM_LINES   60000
+
+int compare_lines(const void* a, const void* b) {
+    return strcmp(*(char**)a, *(char**)b);
+}
+
+int main() {
+    // Lines of varying lengths, with duplicates, and no newline at the end
+    File input = file_open(STR(INPUT_PATH), FileWrite | FileTruncate | FileBinary);
+    ASSERT(file_is_open(input), "File open failed");
+    char** expected = malloc(NUM_LINES * sizeof(char*));
+    uint32_t seed = 12345;
+    for (int i = 0; i < NUM_LINES; i++) {
+        seed = seed * 1103515245 + 12345;
+        char line[64];
+        int len = snprintf(line, sizeof(line), "%u", (seed >> 8) % 50000);
+        for (int j = 0; j < (int)(seed % 20); j++)
+            line[len++] = 'a' + j;
+        line[len] = '\0';
+        expected[i] = strdup(line);
+        file_write_str(&input, STR(line));
+        if (i < NUM_LINES - 1)
+            file_write_str(&input, STR("\n"));
+    }
+    file_close(&input);
+    qsort(expected, NUM_LINES, sizeof(char*), compare_lines);
+
+    // A small budget makes enough runs to need more than one merge pass
+    input = file_open(STR(INPUT_PATH), FileRead | FileBinary);
+    File output = file_open(STR(OUTPUT_PATH), FileWrite | FileTruncate | FileBinary);
+    SortOptions options = {.memory_budget = 64 * 1024, .num_threads = 3};
+    ASSERT(sort_lines(&input, &output, options), "Sort failed");
+    file_close(&output);
+    file_close(&input);
+
+    output = file_open(STR(OUTPUT_PATH), FileRead | FileBinary);
+    str sorted = file_read_all(&output);
+    file_close(&output);
+    Optional(str_pack) split = str_split_packed(sorted, '\n');
+    ASSERT(!split.is_none, "Split failed");
+    str_pack lines = split.val;
+    // Every line ends with a newline, so the last split is empty
+    ASSERT(str_pack_len(lines) == NUM_LINES + 1, "Wrong number of lines");
+    for (int i = 0; i < NUM_LINES; i++)
+        ASSERT(strcmp(str_pack_get(lines, i).data, expected[i]) == 0, "Lines out of order");
+    printf("%d lines\n", NUM_LINES);
+    str_println(str_pack_get(lines, 0));
+    str_println(str_pack_get(lines, NUM_LINES - 1));
+
+    for (int i = 0; i < NUM_LINES; i++)
+        free(expected[i]);
+    free(expected);
+    str_pack_free(lines);
+    free(sorted.data);
+    remove(INPUT_PATH);
+    remove(OUTPUT_PATH);
+    PASS;
+}
@@ -0,0 +1,53 @@
+#include <stdlib.h>
+
+#include "test.h"
+#include "sort.h"
+
+#define INPUT_PATH  "/tmp/fiesta_sort_keyed_input.csv"
+#define OUTPUT_PATH "/tmp/fiesta_sort_keyed_output.csv"
+
+void sort_and_print(SortOptions options) {
+    File input = file_open(STR(INPUT_PATH), FileRead | FileBinary);
+    File output = file_open(STR(OUTPUT_PATH), FileWrite | FileTruncate | FileBinary);
+    bool sorted = sort_lines(&input, &output, options);
+    file_close(&output);
+    file_close(&input);
+    if (!sorted) {
+        puts("sort failed");
+        return;
+    }
+
+    output = file_open(STR(OUTPUT_PATH), FileRead | FileBinary);
+    str contents = file_read_all(&output);
+    str_print(contents);
+    puts("--");
+    free(contents.data);
+    file_close(&output);
+}
+
+int main() {
+    File input = file_open(STR(INPUT_PATH), FileWrite | FileTruncate | FileBinary);
+    ASSERT(file_is_open(input), "File open failed");
+    file_write_str(&input, STR("3,pear,green\n"
+                               "1,apple,red\n"
+                               "2,banana,yellow\n"
+                               "4,apple,green\n"
+                               "5\n"
+                               "1,apple,red\n"
+                               "6,cherry,red\n"
+                               "7,banana,green\n"));
+    file_close(&input);
+
+    // Whole lines
+    sort_and_print((SortOptions){0});
+    // Whole lines, without duplicates
+    sort_and_print((SortOptions){.unique = true});
+    // By the second field, where "5" has an empty key
+    sort_and_print((SortOptions){.key_field = 2, .key_delimiter = ','});
+    // The first line with each third field
+    sort_and_print((SortOptions){.key_field = 3, .key_delimiter = ',', .unique = true, .temp_dir = STR("/tmp")});
+
+    remove(INPUT_PATH);
+    remove(OUTPUT_PATH);
+    PASS;
+}
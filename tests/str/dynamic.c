@@ -8,6 +8,11 @@ int main() {
     dynstr_to_lower(string);
     dynstr_println(string);
 
+    // Failed appends leave the string unchanged
+    ASSERT(dynstr_append_str(&string, STR("!")), "Append failed");
+    ASSERT(!dynstr_append_str(&string, (str){.data = "?", .len = -1}), "Invalid append succeeded");
+    ASSERT(string.len == 10 && string.data[10] == '\0', "Failed append changed the string");
+
     dynstr_free(string);
     PASS;
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include <stdlib.h>
+
+#include "test.h"
+#include "str.h"
+
+int main() {
+    // RFC 4648 test vectors
+    char* vectors[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+    for (int i = 0; i < 7; i++) {
+        dynstr encoded = dynstr_create();
+        ASSERT(str_base64_encode(STR(vectors[i]), Base64Standard, &encoded), "Encode failed");
+        dynstr_append(&encoded, " ");
+        ASSERT(str_base64_encode(STR(vectors[i]), Base64Url, &encoded), "Encode failed");
+        dynstr_append(&encoded, " ");
+        ASSERT(str_hex_encode(STR(vectors[i]), &encoded), "Encode failed");
+        dynstr_println(encoded);
+        dynstr_free(encoded);
+    }
+
+    // Every byte value round trips, through the vector kernels and the scalar code
+    char bytes[1000];
+    for (int i = 0; i < 1000; i++)
+        bytes[i] = (i * 7) & 0xFF;
+    for (int len = 0; len <= 1000; len += 37) {
+        str data = {.data = bytes, .len = len};
+        dynstr encoded = dynstr_create();
+        dynstr decoded = dynstr_create();
+        for (Base64Alphabet alphabet = Base64Standard; alphabet <= Base64Url; alphabet++) {
+            dynstr_clear(&encoded);
+            dynstr_clear(&decoded);
+            str_base64_encode(data, alphabet, &encoded);
+            ASSERT(str_base64_decode(dynstr_to_str(encoded), alphabet, &decoded), "Base64 decode failed");
+            ASSERT(decoded.len == len && memcmp(decoded.data, bytes, len) == 0, "Base64 round trip mismatch");
+        }
+        dynstr_clear(&encoded);
+        dynstr_clear(&decoded);
+        str_hex_encode(data, &encoded);
+        dynstr_to_upper(encoded);
+        ASSERT(str_hex_decode(dynstr_to_str(encoded), &decoded), "Hex decode failed");
+        ASSERT(decoded.len == len && memcmp(decoded.data, bytes, len) == 0, "Hex round trip mismatch");
+        dynstr_free(encoded);
+        dynstr_free(decoded);
+    }
+
+    // Invalid input is rejected, leaving the output as it was
+    dynstr out = DSTR("unchanged");
+    char* invalid_base64[] = {"Zg", "Zg=", "Zh==", "Zm9v\n", "Zm=v", "Zm9v====", "Zm9-", "Z===",
+                              "Zm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYm!y"};
+    for (int i = 0; i < 9; i++)
+        ASSERT(!str_base64_decode(STR(invalid_base64[i]), Base64Standard, &out), "Invalid base64 accepted");
+    ASSERT(!str_base64_decode(STR("Zg=="), Base64Url, &out), "Padded URL-safe base64 accepted");
+    ASSERT(!str_base64_decode(STR("Zm9+"), Base64Url, &out), "Standard character accepted as URL-safe");
+    ASSERT(!str_hex_decode(STR("abc"), &out), "Odd-length hex accepted");
+    ASSERT(!str_hex_decode(STR("0123456789abcdef0123456789abcdefg0"), &out), "Invalid hex accepted");
+    dynstr_println(out);
+    dynstr_free(out);
+
+    PASS;
+}
@@ -0,0 +1,39 @@
+#include "test.h"
+#include "str.h"
+
+int main() {
+    str_pack pack = str_pack_create();
+    ASSERT(str_pack_reserve(&pack, 3, 16), "Reserve failed");
+    ASSERT(str_pack_append(&pack, STR("alpha")), "Append failed");
+    ASSERT(str_pack_append(&pack, STR("")), "Append failed");
+    ASSERT(str_pack_append(&pack, STR("gamma")), "Append failed");
+    str_pack_print(pack);
+    printf("%d %d\n", str_pack_len(pack), str_pack_get(pack, 2).len);
+    ASSERT(str_pack_get(pack, 3).len == 0, "Out of bounds get failed");
+    // Failed reserves and appends leave the array unchanged
+    ASSERT(!str_pack_reserve(&pack, 1, INT_MAX), "Oversized reserve succeeded");
+    ASSERT(!str_pack_append(&pack, (str){.data = "x", .len = -1}), "Invalid append succeeded");
+    ASSERT(str_pack_len(pack) == 3, "Failed append changed the array");
+
+    Optional(str_arr) views_opt = str_pack_to_arr(pack);
+    ASSERT(!views_opt.is_none, "Conversion to array failed");
+    str_arr views = views_opt.val;
+    str_arr_print(views);
+    Optional(str_pack) copy_opt = str_pack_from_arr(views);
+    ASSERT(!copy_opt.is_none, "Conversion from array failed");
+    str_pack copy = copy_opt.val;
+    str_arr_free(views);
+    str_pack_free(pack);
+    str_pack_print(copy);
+    str_pack_clear(&copy);
+    ASSERT(str_pack_len(copy) == 0, "Clear failed");
+    str_pack_free(copy);
+
+    Optional(str_pack) split_opt = str_split_packed(STR("a,bb,,ccc,"), ',');
+    ASSERT(!split_opt.is_none, "Split failed");
+    str_pack split = split_opt.val;
+    str_pack_print(split);
+    str_pack_free(split);
+
+    PASS;
+}
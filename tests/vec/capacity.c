@@ -0,0 +1,38 @@
+#include "test.h"
+#include "vec.h"
+
+int main() {
+    Vec(int) nums = vec_int_create();
+    ASSERT(nums.data == NULL && nums.cap == 0, "Create allocated");
+
+    // Capacities grow in powers of two
+    for (int i = 0; i < 100; i++) {
+        int old_cap = nums.cap;
+        vec_int_push(&nums, i);
+        if (nums.cap != old_cap)
+            printf("%d ", nums.cap);
+    }
+    printf("\n");
+
+    ASSERT(vec_int_reserve(&nums, 200), "Reserve failed");
+    printf("%d %d\n", nums.len, nums.cap);
+    ASSERT(!vec_int_reserve(&nums, -1), "Negative reserve succeeded");
+
+    int extra[] = {100, 101, 102};
+    ASSERT(vec_int_push_n(&nums, extra, 3), "Push n failed");
+    printf("%d %d\n", nums.data[101], nums.data[102]);
+
+    vec_int_shrink_to_fit(&nums);
+    printf("%d %d\n", nums.len, nums.cap);
+
+    // Extending a full vector with itself reads its elements before they move
+    ASSERT(vec_int_extend(&nums, nums), "Extend with itself failed");
+    ASSERT(nums.len == 206 && nums.data[103] == 0 && nums.data[205] == 102, "Extend with itself corrupted");
+
+    vec_int_clear(&nums);
+    vec_int_shrink_to_fit(&nums);
+    ASSERT(nums.data == NULL && nums.cap == 0, "Shrink to fit of an empty vector failed");
+
+    vec_int_free(nums);
+    PASS;
+}
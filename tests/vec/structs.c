@@ -0,0 +1,46 @@
+#include "test.h"
+#include "vec.h"
+
+typedef struct {
+    int id;
+    float weight;
+} Item;
+
+DEFINE_VEC(Item)
+
+void print_items(Vec(Item) items) {
+    for (int i = 0; i < items.len; i++)
+        printf("%d:%.1f ", items.data[i].id, items.data[i].weight);
+    printf("\n");
+}
+
+int main() {
+    Vec(Item) items = vec_Item_create();
+    for (int i = 0; i < 5; i++)
+        ASSERT(vec_Item_push(&items, (Item){.id = i, .weight = i * 0.5f}), "Push failed");
+    print_items(items);
+
+    ASSERT(vec_Item_insert(&items, 0, (Item){.id = 9, .weight = 9.0f}), "Insert failed");
+    ASSERT(!vec_Item_insert(&items, 10, (Item){0}), "Out of bounds insert succeeded");
+    print_items(items);
+
+    Item removed = vec_Item_remove(&items, 1);
+    printf("removed %d\n", removed.id);
+    print_items(items);
+
+    removed = VEC_FN(Item, swap_remove)(&items, 0);
+    printf("swap removed %d\n", removed.id);
+    print_items(items);
+
+    Vec(Item) more = vec_Item_create();
+    vec_Item_push(&more, (Item){.id = 7, .weight = 7.5f});
+    ASSERT(vec_Item_extend(&items, more), "Extend failed");
+    print_items(items);
+
+    vec_Item_clear(&items);
+    ASSERT(items.len == 0, "Clear failed");
+
+    vec_Item_free(more);
+    vec_Item_free(items);
+    PASS;
+}
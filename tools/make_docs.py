@@ -1,10 +1,10 @@
 import sys
 import re
 
-UTILITIES = ["str", "file", "optional"]
+UTILITIES = ["str", "file", "optional", "vec", "matcher", "dir", "journal", "ring", "hash", "sort", "diff"]
 UTILITY_FUNCTIONS = {utility: {} for utility in UTILITIES}
 
-DECLARATION_PATTERN = re.compile(r"(?P<return_type>[0-9A-Za-z_]+)\s+(?P<signature>.+);$")
+DECLARATION_PATTERN = re.compile(r"(?P<return_type>[0-9A-Za-z_]+(\([0-9A-Za-z_]+\))?)\s+(?P<signature>.+);$")
 CODE_PATTERN = re.compile(r"(?P<full>`(?P<text>[^`]+)`)")
 
 HEAD_HTML = """<!DOCTYPE html>
@@ -44,7 +44,7 @@ FOOT_HTML = """</body>
 
 UTILITY_CATEGORIES = {utility: [] for utility in UTILITIES}
 
-TYPENAMES = ["dynstr", "str_arr", "str", "File", "FileAccessModes", "FilePositionOrigin", "Optional", "OptionalPtr", "void", "bool", "char", "uint8_t", "int8_t", "uint16_t", "int16_t", "int", "uint32_t", "int32_t", "ssize_t", "size_t", "uint64_t", "int64_t", "float", "double"]
+TYPENAMES = ["DiffOptions", "DiffEdit", "DiffOp", "diff_edit_arr", "SortOptions", "HashAlgorithm", "Hasher", "RingMode", "RingSlot", "Ring", "JournalOptions", "Journal", "DirListing", "DirWalkOptions", "DirWalkCallback", "DirEntry", "dynstr", "str_arr", "str_pack", "str", "Base64Alphabet", "match_arr", "MatchStream", "MatcherOptions", "Matcher", "FileLineIndex", "FileFollower", "FileStat", "FileAccessHint", "File", "FileAccessModes", "FilePositionOrigin", "Optional", "OptionalPtr", "void", "bool", "char", "uint8_t", "int8_t", "uint16_t", "int16_t", "int", "uint32_t", "int32_t", "ssize_t", "size_t", "uint64_t", "int64_t", "float", "double"]
 
 # Parse utility headers
 for utility in UTILITIES:
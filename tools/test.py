@@ -44,7 +44,7 @@ class TestResult:
         message = f" ({self.message})" if self.message else ""
         print(f"{self.name}: {status_color}{self.status.value}{Color.Reset.value}{message}")
 
-DECL_PATTERN = re.compile(r"^([0-9A-Za-z_#]+)\s+(?P<name>[0-9A-Za-z_]+)\(")
+DECL_PATTERN = re.compile(r"^([0-9A-Za-z_#]+(\([0-9A-Za-z_]+\))?)\s+(?P<name>[0-9A-Za-z_]+)\(")
 HEADER_DIR = "include/fiesta"
 BUILD_DIR = "lib"
 TESTS_DIR = "tests"